@@ -0,0 +1,110 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <utility>
+
+#include "FreeRTOS.h"
+#include "CriticalSection.h"
+
+/*
+ * Monotonic (bump pointer) arena over a fixed buffer. Allocation is an
+ * align-and-add under Lock; there is no per-object free. Memory comes back
+ * all at once through reset(), or back to a mark through rewind() or an
+ * ArenaScope, which makes it a good fit for scratch memory tied to one
+ * request or one received packet.
+ *
+ * Destructors of objects made with create() are never run, so only put
+ * trivially destructible types (or ones whose destructor doesn't matter) in
+ * an arena.
+ */
+template <size_t Size, typename Lock = TaskLock>
+class MonotonicArena {
+public:
+	MonotonicArena() : mUsed(0), mHighWater(0), mFailures(0) {}
+
+	MonotonicArena(const MonotonicArena &) = delete;
+	MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+	/* align must be a power of two */
+	void *allocate(size_t size, size_t align = portBYTE_ALIGNMENT)
+	{
+		Lock lock;
+		uintptr_t base = reinterpret_cast<uintptr_t>(mBuffer);
+		uintptr_t ptr = (base + mUsed + align - 1) & ~(uintptr_t)(align - 1);
+
+		if (ptr + size > base + Size || ptr + size < ptr) {
+			mFailures++;
+			return nullptr;
+		}
+
+		mUsed = ptr + size - base;
+		if (mUsed > mHighWater) {
+			mHighWater = mUsed;
+		}
+
+		return reinterpret_cast<void *>(ptr);
+	}
+
+	template <typename T, typename... Args>
+	T *create(Args &&... args)
+	{
+		void *ptr = allocate(sizeof(T), alignof(T));
+		return ptr ? new (ptr) T(std::forward<Args>(args)...) : nullptr;
+	}
+
+	/* Everything allocated after mark() is released by rewind(mark) */
+	size_t mark(void) const { return mUsed; }
+
+	void rewind(size_t mark)
+	{
+		Lock lock;
+
+		configASSERT(mark <= mUsed);
+		mUsed = mark;
+	}
+
+	void reset(void) { rewind(0); }
+
+	size_t capacity(void) const { return Size; }
+	size_t used(void) const { return mUsed; }
+	size_t highWater(void) const { return mHighWater; }
+	size_t failures(void) const { return mFailures; }
+
+private:
+	alignas(portBYTE_ALIGNMENT) unsigned char mBuffer[Size];
+	size_t mUsed;
+	size_t mHighWater;
+	size_t mFailures;
+};
+
+/* Arena that can be allocated from inside an ISR */
+template <size_t Size>
+using IsrMonotonicArena = MonotonicArena<Size, IsrLock>;
+
+/*
+ * Rewinds an arena to where it was when the scope was entered:
+ *
+ *     {
+ *         ArenaScope<decltype(requestArena)> scope(requestArena);
+ *         Request *req = requestArena.create<Request>(...);
+ *         ...
+ *     }   // req's memory is back in the arena here
+ */
+template <typename Arena>
+class ArenaScope {
+public:
+	explicit ArenaScope(Arena &arena) : mArena(arena), mMark(arena.mark()) {}
+	~ArenaScope() { mArena.rewind(mMark); }
+
+	ArenaScope(const ArenaScope &) = delete;
+	ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+	Arena &mArena;
+	size_t mMark;
+};
+
+#endif /* ARENA_H */
@@ -0,0 +1,165 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <stdint.h>
+
+#include "xtime_l.h"
+#include "xil_printf.h"
+
+/*
+ * Shared pieces for the on-target benchmarks. Timestamps come from the
+ * Cortex-A9 global timer, which ticks at COUNTS_PER_SECOND (half the CPU
+ * clock) and is readable from any context.
+ */
+
+static inline uint64_t benchNow(void)
+{
+	XTime t;
+
+	XTime_GetTime(&t);
+	return t;
+}
+
+static inline uint32_t benchTicksToNs(uint64_t ticks)
+{
+	return (uint32_t)((ticks * 1000000000ull) / COUNTS_PER_SECOND);
+}
+
+static inline uint64_t benchTicksToCycles(uint64_t ticks)
+{
+	return (ticks * XPAR_CPU_CORTEXA9_CORE_CLOCK_FREQ_HZ) / COUNTS_PER_SECOND;
+}
+
+/* Running min/avg/max of a series of samples, in global timer ticks */
+class LatencyStats {
+private:
+	uint64_t mSum;
+	uint32_t mCount;
+	uint32_t mMin;
+	uint32_t mMax;
+
+public:
+	LatencyStats() { reset(); }
+
+	void reset(void)
+	{
+		mSum = 0;
+		mCount = 0;
+		mMin = UINT32_MAX;
+		mMax = 0;
+	}
+
+	void add(uint32_t ticks)
+	{
+		mSum += ticks;
+		mCount++;
+		if (ticks < mMin)
+			mMin = ticks;
+		if (ticks > mMax)
+			mMax = ticks;
+	}
+
+	uint32_t count(void) const { return mCount; }
+	uint32_t minNs(void) const { return mCount ? benchTicksToNs(mMin) : 0; }
+	uint32_t maxNs(void) const { return benchTicksToNs(mMax); }
+	uint32_t avgNs(void) const { return mCount ? benchTicksToNs(mSum / mCount) : 0; }
+
+	void print(const char *name) const
+	{
+		xil_printf("%s: n=%u min=%u avg=%u max=%u ns\r\n",
+				name, mCount, minNs(), avgNs(), maxNs());
+	}
+};
+
+/*
+ * Fixed-width latency histogram, cyclictest style. Samples are given in
+ * global timer ticks and binned in nanoseconds; anything past the last
+ * bucket is counted as an overflow.
+ */
+template <unsigned Buckets>
+class Histogram {
+private:
+	uint32_t mBucketNs;
+	uint32_t mCounts[Buckets];
+	uint32_t mOverflow;
+	uint32_t mTotal;
+
+public:
+	Histogram(uint32_t bucketNs) : mBucketNs(bucketNs) { reset(); }
+
+	void reset(void)
+	{
+		for (unsigned i = 0; i < Buckets; i++)
+			mCounts[i] = 0;
+		mOverflow = 0;
+		mTotal = 0;
+	}
+
+	void add(uint32_t ticks)
+	{
+		uint32_t bucket = benchTicksToNs(ticks) / mBucketNs;
+
+		if (bucket < Buckets)
+			mCounts[bucket]++;
+		else
+			mOverflow++;
+		mTotal++;
+	}
+
+	/* Upper edge of the bucket holding the given percentile (0-1000, in
+	 * tenths of a percent), or UINT32_MAX if it lands in the overflow */
+	uint32_t percentileNs(uint32_t permille) const
+	{
+		uint64_t target = ((uint64_t)mTotal * permille + 999) / 1000;
+		uint64_t seen = 0;
+
+		for (unsigned i = 0; i < Buckets; i++) {
+			seen += mCounts[i];
+			if (seen >= target)
+				return (i + 1) * mBucketNs;
+		}
+
+		return UINT32_MAX;
+	}
+
+	void print(const char *name) const
+	{
+		xil_printf("%s histogram (%u ns buckets, %u samples)\r\n", name, mBucketNs, mTotal);
+		for (unsigned i = 0; i < Buckets; i++) {
+			if (mCounts[i])
+				xil_printf("  %6u ns: %u\r\n", i * mBucketNs, mCounts[i]);
+		}
+		if (mOverflow)
+			xil_printf("  >=%4u ns: %u\r\n", Buckets * mBucketNs, mOverflow);
+		printPercentile("p50", 500);
+		printPercentile("p99", 990);
+		printPercentile("p99.9", 999);
+	}
+
+private:
+	void printPercentile(const char *name, uint32_t permille) const
+	{
+		uint32_t ns = percentileNs(permille);
+
+		if (ns == UINT32_MAX)
+			xil_printf("  %s: off scale\r\n", name);
+		else
+			xil_printf("  %s < %u ns\r\n", name, ns);
+	}
+};
+
+/*
+ * The benchmarks themselves. Each runs to completion in the calling task and
+ * leaves its priority as it found it, except netRateBench(), which needs the
+ * network and never returns. latencyBench(true) needs the network too, and
+ * waits for traffic before it measures.
+ */
+void mboxBench(void);
+void ctxSwitchBench(void);
+void memBench(void);
+void cacheBench(void);
+void streamBench(void);
+void latencyBench(bool underLoad);
+void netRateBench(void);
+
+#endif /* BENCHMARKS_H */
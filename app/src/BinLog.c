@@ -0,0 +1,41 @@
+/*
+ * Deferred-format logging, see BinLog.h. A record costs a critical section,
+ * one timer read and a store per word, whatever the format string says.
+ */
+#include <stdarg.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "xil_io.h"
+#include "xtime_l.h"
+
+#include "BinLog.h"
+
+#if ( BINLOG_WORDS & ( BINLOG_WORDS - 1 ) ) != 0
+	#error BINLOG_WORDS must be a power of two
+#endif
+
+BinLogRing binlogRing;
+
+void binlogWrite(const char *fmt, uint32_t nargs, ...)
+{
+	const uint32_t mask = BINLOG_WORDS - 1;
+	UBaseType_t savedMask;
+	uint32_t head;
+	va_list ap;
+
+	configASSERT(nargs <= BINLOG_MAX_ARGS);
+
+	va_start(ap, nargs);
+	savedMask = taskENTER_CRITICAL_FROM_ISR();
+
+	head = binlogRing.head;
+	binlogRing.buf[head++ & mask] = ((uint32_t)fmt << 4) | nargs;
+	binlogRing.buf[head++ & mask] = Xil_In32(GLOBAL_TMR_BASEADDR + GTIMER_COUNTER_LOWER_OFFSET);
+	while (nargs--)
+		binlogRing.buf[head++ & mask] = va_arg(ap, uint32_t);
+	binlogRing.head = head;
+
+	taskEXIT_CRITICAL_FROM_ISR(savedMask);
+	va_end(ap);
+}
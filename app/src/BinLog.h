@@ -0,0 +1,61 @@
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deferred-format logging for paths where xil_printf is too slow:
+ *
+ *	BINLOG("rx %u bytes on queue %d\n", len, queue);
+ *
+ * The format string goes in the .binlog section, which lscript.ld does not
+ * load. The call stores only the string's address in that section, a
+ * global timer timestamp and the raw arguments in binlogRing, with no
+ * formatting and no UART. Halt the target, dump binlogRing over JTAG, and
+ * tools/binlog turns the dump back into text using the format strings in
+ * the ELF.
+ *
+ * Each argument is stored as one 32-bit word. That covers integers, chars
+ * and pointers, but not 64-bit values or doubles. %s arguments are looked up
+ * in the ELF, so they must point at constant strings, not at buffers filled
+ * at run time. BINLOG can be called from tasks and from interrupts up to
+ * configMAX_API_CALL_INTERRUPT_PRIORITY. Once the ring is full the oldest
+ * records are overwritten.
+ */
+
+/* Ring size in 32-bit words, a power of two. A record takes 2 words plus
+ * one per argument. */
+#ifndef BINLOG_WORDS
+#define BINLOG_WORDS		4096
+#endif
+
+#define BINLOG_MAX_ARGS		8
+
+typedef struct {
+	volatile uint32_t head;		/* words ever written, the next goes at head % BINLOG_WORDS */
+	uint32_t buf[BINLOG_WORDS];
+} BinLogRing;
+
+extern BinLogRing binlogRing;
+
+/* Record layout: (format string address << 4) | argument count, then the
+ * lower 32 bits of the global timer, then the arguments */
+void binlogWrite(const char *fmt, uint32_t nargs, ...);
+
+#define BINLOG_NARGS(...)	BINLOG_NARGS_(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define BINLOG_NARGS_(_, a1, a2, a3, a4, a5, a6, a7, a8, n, ...)	n
+
+#define BINLOG(fmt, ...) do { \
+	static const char binlogFmt[] __attribute__ ((section (".binlog"))) = fmt; \
+	binlogWrite(binlogFmt, BINLOG_NARGS(__VA_ARGS__), ##__VA_ARGS__); \
+} while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BINLOG_H */
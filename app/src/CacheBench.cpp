@@ -0,0 +1,83 @@
+#include <string.h>
+
+#include "xil_printf.h"
+#include "xil_cache.h"
+#include "xil_cache_l.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Benchmarks.h"
+
+/*
+ * Cost of data cache maintenance against buffer size, in CPU cycles. Each
+ * case dirties the buffer first, so the time includes writing it back.
+ *
+ *   lines    Xil_DCacheFlushLine() over the range, which syncs the L2 after
+ *            every line the way the range functions used to
+ *   flush    Xil_DCacheFlushRange(), batched, switching to whole-cache
+ *            operations from XIL_DCACHE_L{1,2}_FLUSH_ALL_LEN bytes
+ *   inval    Xil_DCacheInvalidateRange(), batched
+ *   all      Xil_DCacheFlush(), for comparison with the above
+ *
+ * Where "all" beats "flush" for sizes under the thresholds, they are set too
+ * high, and the other way round.
+ */
+
+#define CACHE_BENCH_MAX_SIZE	(1024 * 1024)
+#define CACHE_BENCH_ROUNDS		4
+
+static uint8_t buffer[CACHE_BENCH_MAX_SIZE] __attribute__ ((aligned (32)));
+
+enum CacheOp {
+	OP_LINES,
+	OP_FLUSH,
+	OP_INVALIDATE,
+	OP_FLUSH_ALL,
+};
+
+static void runOp(CacheOp op, u32 size)
+{
+	switch (op) {
+	case OP_LINES:
+		for (u32 adr = (u32)buffer; adr < (u32)buffer + size; adr += 32)
+			Xil_DCacheFlushLine(adr);
+		break;
+	case OP_FLUSH:
+		Xil_DCacheFlushRange((INTPTR)buffer, size);
+		break;
+	case OP_INVALIDATE:
+		Xil_DCacheInvalidateRange((INTPTR)buffer, size);
+		break;
+	case OP_FLUSH_ALL:
+		Xil_DCacheFlush();
+		break;
+	}
+}
+
+static uint32_t timeOp(CacheOp op, u32 size)
+{
+	uint64_t ticks = 0;
+	uint64_t start;
+
+	for (int i = 0; i < CACHE_BENCH_ROUNDS; i++) {
+		memset(buffer, i, size);
+		start = benchNow();
+		runOp(op, size);
+		ticks += benchNow() - start;
+	}
+
+	return (uint32_t)(benchTicksToCycles(ticks) / CACHE_BENCH_ROUNDS);
+}
+
+void cacheBench(void)
+{
+	xil_printf("Cache maintenance (cycles), full flush from %u KB in L1, %u KB in L2\r\n",
+			XIL_DCACHE_L1_FLUSH_ALL_LEN / 1024, XIL_DCACHE_L2_FLUSH_ALL_LEN / 1024);
+	xil_printf("  %8s %10s %10s %10s %10s\r\n", "bytes", "lines", "flush", "inval", "all");
+
+	for (u32 size = 256; size <= CACHE_BENCH_MAX_SIZE; size *= 2) {
+		xil_printf("  %8u %10u %10u %10u %10u\r\n", size,
+				timeOp(OP_LINES, size), timeOp(OP_FLUSH, size),
+				timeOp(OP_INVALIDATE, size), timeOp(OP_FLUSH_ALL, size));
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef CRITICAL_SECTION_H
+#define CRITICAL_SECTION_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*
+ * Scoped lock policies for the pool and arena templates, also usable on
+ * their own.
+ *
+ * TaskLock is a taskENTER_CRITICAL()/taskEXIT_CRITICAL() pair and asserts if
+ * used from an interrupt. IsrLock masks interrupts at or below
+ * configMAX_API_CALL_INTERRUPT_PRIORITY and restores the previous mask, so it
+ * is safe from ISRs and tasks alike. NoLock is for objects only ever touched
+ * by a single task.
+ */
+class TaskLock {
+public:
+	TaskLock() { taskENTER_CRITICAL(); }
+	~TaskLock() { taskEXIT_CRITICAL(); }
+
+	TaskLock(const TaskLock &) = delete;
+	TaskLock &operator=(const TaskLock &) = delete;
+};
+
+class IsrLock {
+public:
+	IsrLock() : mSavedMask(taskENTER_CRITICAL_FROM_ISR()) {}
+	~IsrLock() { taskEXIT_CRITICAL_FROM_ISR(mSavedMask); }
+
+	IsrLock(const IsrLock &) = delete;
+	IsrLock &operator=(const IsrLock &) = delete;
+
+private:
+	UBaseType_t mSavedMask;
+};
+
+class NoLock {
+public:
+	NoLock() {}
+};
+
+#endif /* CRITICAL_SECTION_H */
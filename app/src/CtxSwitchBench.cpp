@@ -0,0 +1,101 @@
+#include "xil_printf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Benchmarks.h"
+
+/*
+ * Context switch cost, with and without the FPU in play. Two tasks at the
+ * same priority hand a notification back and forth, so every round trip is
+ * two switches. Either task can be made to touch the FPU on each turn.
+ *
+ * With eager FPU switching (configUSE_TASK_FPU_SUPPORT 2) every switch moves
+ * all 32 double registers both ways whatever the tasks do. With lazy
+ * switching (3) that only happens when the FPU changes hands, so the
+ * integer-only case and the one-task-uses-FPU case should come out cheaper.
+ */
+
+#define CTX_BENCH_ROUNDS 20000
+
+#if configUSE_TASK_FPU_SUPPORT == 3
+extern "C" volatile uint32_t ulPortFPUSwitches;
+#endif
+
+struct CtxBench {
+	TaskHandle_t ping;
+	TaskHandle_t pong;
+	volatile bool pingUsesFpu;
+	volatile bool pongUsesFpu;
+};
+
+static CtxBench bench;
+static volatile float fpuScratch = 1.0f;
+
+static inline void touchFpu(void)
+{
+	fpuScratch = fpuScratch * 1.0001f + 0.5f;
+}
+
+static void pongTask(void *)
+{
+	/* Only matters with configUSE_TASK_FPU_SUPPORT 1 */
+	portTASK_USES_FLOATING_POINT();
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		if (bench.pongUsesFpu)
+			touchFpu();
+		xTaskNotifyGive(bench.ping);
+	}
+}
+
+static void runCase(const char *name, bool pingUsesFpu, bool pongUsesFpu)
+{
+	uint64_t start, ticks;
+#if configUSE_TASK_FPU_SUPPORT == 3
+	uint32_t fpuSwitches = ulPortFPUSwitches;
+#endif
+
+	bench.pingUsesFpu = pingUsesFpu;
+	bench.pongUsesFpu = pongUsesFpu;
+
+	start = benchNow();
+	for (int i = 0; i < CTX_BENCH_ROUNDS; i++) {
+		if (pingUsesFpu)
+			touchFpu();
+		xTaskNotifyGive(bench.pong);
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+	ticks = benchNow() - start;
+
+	xil_printf("  %-22s %u cycles/switch", name,
+			(uint32_t)(benchTicksToCycles(ticks) / (2 * CTX_BENCH_ROUNDS)));
+#if configUSE_TASK_FPU_SUPPORT == 3
+	xil_printf(", %u FPU handovers", ulPortFPUSwitches - fpuSwitches);
+#endif
+	xil_printf("\r\n");
+}
+
+void ctxSwitchBench(void)
+{
+	UBaseType_t priority = uxTaskPriorityGet(NULL);
+
+	portTASK_USES_FLOATING_POINT();
+	bench.ping = xTaskGetCurrentTaskHandle();
+	vTaskPrioritySet(NULL, configMAX_PRIORITIES - 1);
+
+	if (xTaskCreate(pongTask, "ctx_pong", configMINIMAL_STACK_SIZE * 2, NULL,
+			configMAX_PRIORITIES - 1, &bench.pong) != pdPASS) {
+		xil_printf("%s: failed to create pong task\r\n", __FUNCTION__);
+		vTaskPrioritySet(NULL, priority);
+		return;
+	}
+
+	xil_printf("Context switch, configUSE_TASK_FPU_SUPPORT %d\r\n", configUSE_TASK_FPU_SUPPORT);
+	runCase("no FPU", false, false);
+	runCase("one task uses FPU", true, false);
+	runCase("both tasks use FPU", true, true);
+
+	vTaskDelete(bench.pong);
+	vTaskPrioritySet(NULL, priority);
+}
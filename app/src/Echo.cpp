@@ -9,6 +9,9 @@
 #include "task.h"
 
 #include "SteTcp.h"
+#include "Arena.h"
+#include "Profile.h"
+#include "BinLog.h"
 
 #define THREAD_STACKSIZE 1024
 
@@ -16,6 +19,37 @@ static SteTcpServer tcpServer;
 static SteTcpServer tcpCtrlServer;
 static SteTcpServer tcpTelnet;
 
+/* Held open for as long as the application runs */
+static SteTcpConnection *dataConn;
+static SteTcpConnection *ctrlConn;
+
+/* Scratch for one telnet request, given back when the request is done */
+static MonotonicArena<256, NoLock> requestArena;
+
+/* The received bytes as one line of decimals, so the console gets a single
+ * print per request rather than one per byte */
+static const char *formatRequest(const uint8_t *data, int n)
+{
+	char *line = static_cast<char *>(requestArena.allocate(n * 4 + 1, 1));
+	char *p = line;
+
+	if (!line)
+		return "(request too long to print)";
+
+	for (int i = 0; i < n; i++) {
+		uint8_t v = data[i];
+
+		if (v >= 100)
+			*p++ = '0' + v / 100;
+		if (v >= 10)
+			*p++ = '0' + (v / 10) % 10;
+		*p++ = '0' + v % 10;
+		*p++ = ' ';
+	}
+	*p = '\0';
+	return line;
+}
+
 void echo_application_thread(void *)
 {
 	tcpServer.init(16154);
@@ -23,9 +57,9 @@ void echo_application_thread(void *)
 	tcpTelnet.init(7);
 
 	xil_printf("Waiting for connections from both ports\n\r");
-	tcpServer.acceptConnection();
+	dataConn = tcpServer.acceptConnection();
 	xil_printf("Received connection from Data Port\n\r");
-	tcpCtrlServer.acceptConnection();
+	ctrlConn = tcpCtrlServer.acceptConnection();
 	xil_printf("Received connection from Control Port\n\r");
 
 	/////////////////////////////////////////////
@@ -35,12 +69,15 @@ void echo_application_thread(void *)
 
 	while (1) {
 		xil_printf("Waiting for telnet connection on port 7\n\r");
-		tcpTelnet.acceptConnection();
+		SteTcpConnection *telnet = tcpTelnet.acceptConnection();
+
+		if (!telnet)
+			continue;
 		xil_printf("Received connection from Telnet port\n\r");
 
 		while (1) {
 			/* read a max of RECV_BUF_SIZE bytes from socket */
-			if ((n = tcpTelnet.rx(recv_buf, RECV_BUF_SIZE)) < 0) {
+			if ((n = telnet->rx(recv_buf, RECV_BUF_SIZE)) < 0) {
 				xil_printf("%s: error reading from Telnet socket, closing socket\r\n", __FUNCTION__);
 				break;
 			}
@@ -49,24 +86,42 @@ void echo_application_thread(void *)
 			if (n <= 0)
 				break;
 
-			xil_printf("Received:\n\r");
-			for (uint8_t i = 0; i < n; i++) {
-				xil_printf("%d ", recv_buf[i]);
+			BINLOG("telnet: %d bytes, first 0x%02x\n", n, recv_buf[0]);
+
+#ifdef PROFILE_ZONES
+			/* Ctrl-P prints the profile table and starts a new one */
+			if (n == 1 && recv_buf[0] == 0x10) {
+				profileDump();
+				profileReset();
+				continue;
+			}
+#endif
+
+			{
+				ProfileZone zone("telnet_print");
+				ArenaScope<decltype(requestArena)> scope(requestArena);
+
+				xil_printf("Received:\n\r%s\n\r", formatRequest(recv_buf, n));
 			}
-			xil_printf("\n\r");
 
 			/* handle request */
-			if ((nwrote = tcpTelnet.tx(recv_buf, n)) < 0) {
+			{
+				ProfileZone zone("telnet_tx");
+
+				nwrote = telnet->tx(recv_buf, n);
+			}
+			if (nwrote < 0) {
 				xil_printf("%s: ERROR responding to client echo request. received = %d, written = %d\r\n",
 						__FUNCTION__, n, nwrote);
 				xil_printf("Closing socket\r\n");
 				break;
 			}
 		}
+
+		/* close connection */
+		delete telnet;
 	}
 
-	/* close connection */
-	tcpTelnet.closeClient();
 	tcpTelnet.closeServer();
 
 	xil_printf("Maximum number of connections reached, No further connections will be accepted\r\n");
@@ -0,0 +1,289 @@
+#include <string.h>
+
+#include "lwip/sockets.h"
+#include "netif/xadapter.h"
+#include "lwipopts.h"
+#include "xil_printf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "SteTcp.h"
+#include "qspi.h"
+#include "crc32.h"
+#include "FlashUpdate.h"
+
+/*
+ * Network update service. The image is written to QSPI while it streams in:
+ * this thread fills one 64KB buffer from the socket while a writer task
+ * erases, programs and reads back the block in the other one, so a full
+ * BOOT.BIN takes about as long as the flash needs to write it. Blocks that
+ * already hold the right data are left alone.
+ *
+ * The image goes to the inactive A/B boot slot. Its version record and the
+ * sector with its boot header are erased first. The header sector is kept
+ * in headerSector while the rest streams in, and is only programmed once
+ * every block has been written and verified and the CRC-32 of the image
+ * matches the header. Then the record is written back, making the slot the
+ * one the FSBL boots, and the client hears FLASH_UPDATE_OK. A failed or
+ * interrupted update leaves the slot without a boot header, so the BootROM
+ * and the FSBL both pass it over for the running image in the other slot.
+ */
+
+#define THREAD_STACKSIZE 1024
+
+#define UPDATE_BUFFERS 2
+
+struct UpdateBlock {
+	uint8_t *data;		/* nullptr marks the end of an image */
+	uint32_t offset;
+	uint32_t len;
+};
+
+/* Filled from the socket before they're read, no need to clear them */
+static uint8_t blockBuffers[UPDATE_BUFFERS][QSPI_BLOCK_SIZE] __attribute__ ((section (".noinit")));
+
+static QueueHandle_t freeBuffers;	/* uint8_t *, ready to be filled */
+static QueueHandle_t fullBlocks;	/* UpdateBlock, waiting to be written */
+static QueueHandle_t results;		/* FlashUpdateReply, one per image */
+
+/* The image's first SLOT_HEADER_SIZE bytes, held back until the rest is in */
+static uint8_t headerSector[SLOT_HEADER_SIZE];
+
+static bool blockMatchesFlash(const UpdateBlock &block)
+{
+	static uint8_t flash[QSPI_READ_CHUNK];
+
+	for (uint32_t done = 0; done < block.len; done += QSPI_READ_CHUNK) {
+		uint32_t size = (block.len - done > QSPI_READ_CHUNK) ? QSPI_READ_CHUNK : block.len - done;
+
+		if (qspi.read(block.offset + done, flash, size) != XST_SUCCESS)
+			return false;
+		if (memcmp(flash, block.data + done, size) != 0)
+			return false;
+	}
+	return true;
+}
+
+static uint32_t writeBlock(const UpdateBlock &block, uint32_t *crc)
+{
+	if (!blockMatchesFlash(block)) {
+		if (qspi.eraseBlock(block.offset) != XST_SUCCESS ||
+				qspi.program(block.offset, block.data, block.len) != XST_SUCCESS)
+			return FLASH_UPDATE_FLASH_ERROR;
+
+		if (!blockMatchesFlash(block))
+			return FLASH_UPDATE_VERIFY_FAILED;
+	}
+
+	/* The flash holds exactly this now */
+	*crc = crc32Update(*crc, block.data, block.len);
+	return FLASH_UPDATE_OK;
+}
+
+static void flash_writer_thread(void *)
+{
+	FlashUpdateReply reply = { FLASH_UPDATE_OK, 0 };
+
+	while (1) {
+		UpdateBlock block;
+
+		xQueueReceive(fullBlocks, &block, portMAX_DELAY);
+
+		if (block.data == nullptr) {
+			xQueueSend(results, &reply, portMAX_DELAY);
+			reply.status = FLASH_UPDATE_OK;
+			reply.crc32 = 0;
+			continue;
+		}
+
+		/* After a failure keep taking blocks, so the receiver isn't stuck,
+		 * but leave the flash alone */
+		if (reply.status == FLASH_UPDATE_OK)
+			reply.status = writeBlock(block, &reply.crc32);
+
+		xQueueSend(freeBuffers, &block.data, portMAX_DELAY);
+	}
+}
+
+static bool recvAll(SteTcpConnection &conn, void *data, uint32_t len)
+{
+	uint8_t *dst = static_cast<uint8_t *>(data);
+
+	while (len > 0) {
+		int32_t n = conn.rx(dst, len);
+
+		if (n <= 0)
+			return false;
+		dst += n;
+		len -= n;
+	}
+	return true;
+}
+
+static void readSlotRecords(SlotRecord records[SLOT_COUNT])
+{
+	for (int slot = 0; slot < SLOT_COUNT; slot++) {
+		if (qspi.read(SLOT_RECORD(slot), reinterpret_cast<uint8_t *>(&records[slot]),
+				sizeof(SlotRecord)) != XST_SUCCESS)
+			memset(&records[slot], 0, sizeof(SlotRecord));
+	}
+}
+
+/* Programs the held boot header into the sector erased for it */
+static uint32_t writeHeader(int slot, uint32_t len)
+{
+	UpdateBlock block = { headerSector, SLOT_BASE(slot), len };
+
+	if (qspi.program(block.offset, block.data, block.len) != XST_SUCCESS)
+		return FLASH_UPDATE_FLASH_ERROR;
+	if (!blockMatchesFlash(block))
+		return FLASH_UPDATE_VERIFY_FAILED;
+	return FLASH_UPDATE_OK;
+}
+
+/* Makes the slot the one to boot */
+static uint32_t commitSlot(int slot, const SlotRecord records[SLOT_COUNT],
+		uint32_t size, uint32_t crc, uint32_t *sequence)
+{
+	SlotRecord record, check;
+
+	slotRecordMake(&record, records, size, crc);
+	if (qspi.program(SLOT_RECORD(slot), reinterpret_cast<uint8_t *>(&record), sizeof(record)) != XST_SUCCESS ||
+			qspi.read(SLOT_RECORD(slot), reinterpret_cast<uint8_t *>(&check), sizeof(check)) != XST_SUCCESS)
+		return FLASH_UPDATE_FLASH_ERROR;
+	if (memcmp(&record, &check, sizeof(record)) != 0)
+		return FLASH_UPDATE_VERIFY_FAILED;
+
+	*sequence = record.sequence;
+	return FLASH_UPDATE_OK;
+}
+
+static void handleUpdate(SteTcpConnection &conn)
+{
+	FlashUpdateHeader header;
+	FlashUpdateReply reply = { FLASH_UPDATE_BAD_HEADER, 0, 0, 0 };
+	UpdateBlock end = { nullptr, 0, 0 };
+	SlotRecord records[SLOT_COUNT];
+	uint32_t headerLen;
+	uint32_t offset;
+	bool complete = true;
+	int slot;
+
+	if (!recvAll(conn, &header, sizeof(header)))
+		return;
+
+	if (header.magic != FLASH_UPDATE_MAGIC || header.size == 0 ||
+			header.size > FLASH_UPDATE_MAX_SIZE) {
+		xil_printf("Update: bad header\r\n");
+		conn.tx(reinterpret_cast<uint8_t *>(&reply), sizeof(reply));
+		return;
+	}
+
+	/* The writer is idle between images, the flash is ours */
+	readSlotRecords(records);
+	slot = slotInactive(records);
+	reply.slot = slot;
+
+	/* Until its new record goes in, the slot doesn't boot, and until its
+	 * boot header does, the BootROM skips it */
+	if (qspi.eraseBlock(SLOT_RECORD(slot)) != XST_SUCCESS ||
+			qspi.eraseSector(SLOT_BASE(slot)) != XST_SUCCESS) {
+		reply.status = FLASH_UPDATE_FLASH_ERROR;
+		conn.tx(reinterpret_cast<uint8_t *>(&reply), sizeof(reply));
+		return;
+	}
+
+	xil_printf("Update: receiving %u bytes into slot %c\r\n", header.size, SLOT_NAME(slot));
+
+	headerLen = (header.size > SLOT_HEADER_SIZE) ? SLOT_HEADER_SIZE : header.size;
+	if (!recvAll(conn, headerSector, headerLen)) {
+		xil_printf("Update: connection lost, slot %c left without an image\r\n", SLOT_NAME(slot));
+		return;
+	}
+	offset = headerLen;
+
+	while (offset < header.size) {
+		UpdateBlock block;
+
+		xQueueReceive(freeBuffers, &block.data, portMAX_DELAY);
+		block.offset = SLOT_BASE(slot) + offset;
+		/* Up to the next block boundary, the first block is short by the
+		 * header */
+		block.len = QSPI_BLOCK_SIZE - (offset % QSPI_BLOCK_SIZE);
+		if (block.len > header.size - offset)
+			block.len = header.size - offset;
+
+		if (!recvAll(conn, block.data, block.len)) {
+			xQueueSend(freeBuffers, &block.data, portMAX_DELAY);
+			complete = false;
+			break;
+		}
+
+		xQueueSend(fullBlocks, &block, portMAX_DELAY);
+		offset += block.len;
+	}
+
+	/* Wait for the writer to finish the last block */
+	xQueueSend(fullBlocks, &end, portMAX_DELAY);
+	xQueueReceive(results, &reply, portMAX_DELAY);
+
+	if (!complete) {
+		xil_printf("Update: connection lost after %u of %u bytes, slot %c left without an image\r\n",
+				offset, header.size, SLOT_NAME(slot));
+		return;
+	}
+
+	reply.slot = slot;
+	reply.crc32 = crc32Combine(crc32Update(0, headerSector, headerLen), reply.crc32,
+			header.size - headerLen);
+	if (reply.status == FLASH_UPDATE_OK && reply.crc32 != header.crc32)
+		reply.status = FLASH_UPDATE_CRC_MISMATCH;
+	if (reply.status == FLASH_UPDATE_OK)
+		reply.status = writeHeader(slot, headerLen);
+	if (reply.status == FLASH_UPDATE_OK)
+		reply.status = commitSlot(slot, records, header.size, reply.crc32, &reply.sequence);
+
+	xil_printf("Update: %s (status %u, CRC32 0x%08x, slot %c, sequence %u)\r\n",
+			reply.status == FLASH_UPDATE_OK ? "done" : "FAILED", reply.status, reply.crc32,
+			SLOT_NAME(slot), reply.sequence);
+	conn.tx(reinterpret_cast<uint8_t *>(&reply), sizeof(reply));
+}
+
+void flash_update_thread(void *)
+{
+	static SteTcpServer server;
+
+	crc32Init();
+
+	freeBuffers = xQueueCreate(UPDATE_BUFFERS, sizeof(uint8_t *));
+	fullBlocks = xQueueCreate(UPDATE_BUFFERS + 1, sizeof(UpdateBlock));
+	results = xQueueCreate(1, sizeof(FlashUpdateReply));
+	configASSERT(freeBuffers && fullBlocks && results);
+
+	for (int i = 0; i < UPDATE_BUFFERS; i++) {
+		uint8_t *data = blockBuffers[i];
+
+		xQueueSend(freeBuffers, &data, 0);
+	}
+
+	sys_thread_new("flash_writer", flash_writer_thread, NULL,
+			THREAD_STACKSIZE,
+			DEFAULT_THREAD_PRIO);
+
+	if (server.init(FLASH_UPDATE_PORT) != SteTcpServer::PASS) {
+		vTaskDelete(NULL);
+		return;
+	}
+
+	xil_printf("Flash update service on port %u\r\n", FLASH_UPDATE_PORT);
+
+	while (1) {
+		SteTcpConnection *conn = server.acceptConnection();
+
+		if (!conn)
+			continue;
+		handleUpdate(*conn);
+		delete conn;
+	}
+}
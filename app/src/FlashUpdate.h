@@ -0,0 +1,44 @@
+#ifndef FLASH_UPDATE_H
+#define FLASH_UPDATE_H
+
+#include <stdint.h>
+
+#include "slots.h"
+
+/*
+ * Wire format of the network update service (FlashUpdate.cpp), shared with
+ * the host side in tools/netflash. All words are little-endian.
+ *
+ * The client connects to FLASH_UPDATE_PORT and sends a FlashUpdateHeader
+ * followed by size bytes of image, which the board writes to the inactive
+ * A/B boot slot (see flasher/slots.h). Once every block has been written and
+ * read back, and the slot's version record committed, the board answers with
+ * one FlashUpdateReply and closes the connection.
+ */
+
+#define FLASH_UPDATE_PORT		16156
+#define FLASH_UPDATE_MAGIC		0x44505546	/* "FUPD" */
+#define FLASH_UPDATE_MAX_SIZE	SLOT_IMAGE_MAX
+
+typedef struct {
+	uint32_t magic;
+	uint32_t size;			/* image bytes that follow */
+	uint32_t crc32;			/* zlib CRC-32 of the image */
+} FlashUpdateHeader;
+
+typedef struct {
+	uint32_t status;		/* FlashUpdateStatus */
+	uint32_t crc32;			/* CRC-32 of what was read back from flash */
+	uint32_t slot;			/* boot slot written, 0 for A */
+	uint32_t sequence;		/* its record's sequence number, 0 if not committed */
+} FlashUpdateReply;
+
+enum FlashUpdateStatus {
+	FLASH_UPDATE_OK = 0,
+	FLASH_UPDATE_BAD_HEADER,		/* wrong magic, or size 0 or too large */
+	FLASH_UPDATE_FLASH_ERROR,		/* an erase or program command failed */
+	FLASH_UPDATE_VERIFY_FAILED,		/* a block read back differently */
+	FLASH_UPDATE_CRC_MISMATCH,		/* the image isn't what the header promised */
+};
+
+#endif /* FLASH_UPDATE_H */
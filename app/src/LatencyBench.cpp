@@ -0,0 +1,234 @@
+#include "xparameters.h"
+#include "xscugic.h"
+#include "xil_io.h"
+#include "xil_cache.h"
+#include "xil_printf.h"
+#include "lwip/stats.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Benchmarks.h"
+#include "Ocm.h"
+
+/*
+ * cyclictest-style latency benchmark. The global timer's comparator fires
+ * an interrupt every LATENCY_BENCH_PERIOD_US, and because the comparator
+ * holds the exact tick the interrupt was due on, the ISR can measure its own
+ * entry latency with no reference error. The ISR then wakes the highest
+ * priority task with a direct notification and the task measures how long
+ * that took.
+ *
+ * Results are printed every LATENCY_BENCH_WINDOW_MS, for
+ * LATENCY_BENCH_WINDOWS windows, along with the number of frames lwIP
+ * received in that window. It runs twice: once idle, before the network is
+ * brought up, where that count should be 0, and once under network load,
+ * where the GEM's interrupts and the stack's work compete with the timer.
+ * The loaded pass waits until at least LATENCY_BENCH_LOAD_FRAMES frames a
+ * second are coming in before it starts measuring, e.g. from
+ *
+ *	iperf -u -c <board ip> -p 5001 -b 200M -l 64
+ *
+ * The GEM's own frame counter can't be used, it clears on read and the lwIP
+ * port relies on it to spot a stuck receiver.
+ *
+ * With LATENCY_BENCH_COLD_CACHE set the task flushes and invalidates the
+ * caches after every sample, so each interrupt is taken with the whole
+ * handler path cold. That is where OCM_HOT_CODE=1 and 0 builds differ; with
+ * warm caches the code runs from L1 wherever it is linked.
+ */
+
+#ifndef LATENCY_BENCH_PERIOD_US
+#define LATENCY_BENCH_PERIOD_US 1000
+#endif
+
+#ifndef LATENCY_BENCH_WINDOW_MS
+#define LATENCY_BENCH_WINDOW_MS 10000
+#endif
+
+#ifndef LATENCY_BENCH_WINDOWS
+#define LATENCY_BENCH_WINDOWS 3
+#endif
+
+#ifndef LATENCY_BENCH_LOAD_FRAMES
+#define LATENCY_BENCH_LOAD_FRAMES 1000
+#endif
+
+#ifndef LATENCY_BENCH_COLD_CACHE
+#define LATENCY_BENCH_COLD_CACHE 0
+#endif
+
+/* GIC priority of the benchmark interrupt. The default is the most urgent
+ * priority that may still call FreeRTOS API functions. */
+#ifndef LATENCY_BENCH_IRQ_PRIORITY
+#define LATENCY_BENCH_IRQ_PRIORITY configMAX_API_CALL_INTERRUPT_PRIORITY
+#endif
+
+/* Global timer registers past the ones xtime_l.h defines */
+#define GTIMER_STATUS_OFFSET			0x0CU
+#define GTIMER_COMPARE_LOWER_OFFSET		0x10U
+#define GTIMER_COMPARE_UPPER_OFFSET		0x14U
+#define GTIMER_AUTOINC_OFFSET			0x18U
+
+#define GTIMER_CONTROL_TIMER_ENABLE		0x01U
+#define GTIMER_CONTROL_COMP_ENABLE		0x02U
+#define GTIMER_CONTROL_IRQ_ENABLE		0x04U
+#define GTIMER_CONTROL_AUTO_INCREMENT	0x08U
+
+#define LATENCY_BENCH_PERIOD_TICKS ((uint32_t)(((uint64_t)COUNTS_PER_SECOND * LATENCY_BENCH_PERIOD_US) / 1000000))
+
+extern XScuGic xInterruptController;
+
+static TaskHandle_t benchTask;
+static volatile uint64_t isrEntry;
+static volatile uint32_t irqLatency;
+
+OCM_TEXT static void latencyIsr(void *)
+{
+	uint64_t now = benchNow();
+	uint64_t due;
+	BaseType_t woken = pdFALSE;
+
+	/* With auto-increment on, the comparator has already moved on to the
+	 * next period by the time we get here */
+	due = ((uint64_t)Xil_In32(GLOBAL_TMR_BASEADDR + GTIMER_COMPARE_UPPER_OFFSET) << 32) |
+			Xil_In32(GLOBAL_TMR_BASEADDR + GTIMER_COMPARE_LOWER_OFFSET);
+	due -= LATENCY_BENCH_PERIOD_TICKS;
+
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_STATUS_OFFSET, 1);
+
+	irqLatency = (uint32_t)(now - due);
+	isrEntry = now;
+
+	vTaskNotifyGiveFromISR(benchTask, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+static void startTimer(void)
+{
+	uint64_t first = benchNow() + LATENCY_BENCH_PERIOD_TICKS;
+
+	/* The comparator must be disabled while it's being written. Leave the
+	 * timer itself running, XTime_GetTime() depends on it. */
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_CONTROL_OFFSET, GTIMER_CONTROL_TIMER_ENABLE);
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_STATUS_OFFSET, 1);
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_COMPARE_LOWER_OFFSET, (uint32_t)first);
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_COMPARE_UPPER_OFFSET, (uint32_t)(first >> 32));
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_AUTOINC_OFFSET, LATENCY_BENCH_PERIOD_TICKS);
+
+	xPortInstallInterruptHandler(XPAR_GLOBAL_TMR_INTR, latencyIsr, NULL);
+	XScuGic_SetPriorityTriggerType(&xInterruptController, XPAR_GLOBAL_TMR_INTR,
+			LATENCY_BENCH_IRQ_PRIORITY << portPRIORITY_SHIFT, 0x3);
+	vPortEnableInterrupt(XPAR_GLOBAL_TMR_INTR);
+
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_CONTROL_OFFSET,
+			GTIMER_CONTROL_TIMER_ENABLE | GTIMER_CONTROL_COMP_ENABLE |
+			GTIMER_CONTROL_IRQ_ENABLE | GTIMER_CONTROL_AUTO_INCREMENT);
+}
+
+static void stopTimer(void)
+{
+	vPortDisableInterrupt(XPAR_GLOBAL_TMR_INTR);
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_CONTROL_OFFSET, GTIMER_CONTROL_TIMER_ENABLE);
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_STATUS_OFFSET, 1);
+}
+
+/* Blocks until lwIP receives LATENCY_BENCH_LOAD_FRAMES frames within a
+ * second, polled in tenths so the 16-bit counter can't wrap in between */
+static void waitForLoad(void)
+{
+	xil_printf("\r\nLatency under load: waiting for %u rx frames/s, e.g. UDP to port 5001\r\n",
+			LATENCY_BENCH_LOAD_FRAMES);
+
+	while (1) {
+		STAT_COUNTER last = lwip_stats.link.recv;
+		uint32_t frames = 0;
+
+		for (int i = 0; i < 10; i++) {
+			STAT_COUNTER recv;
+
+			vTaskDelay(pdMS_TO_TICKS(100));
+			recv = lwip_stats.link.recv;
+			frames += (STAT_COUNTER)(recv - last);
+			last = recv;
+		}
+
+		if (frames >= LATENCY_BENCH_LOAD_FRAMES)
+			return;
+	}
+}
+
+void latencyBench(bool underLoad)
+{
+	const uint32_t samplesPerWindow = (LATENCY_BENCH_WINDOW_MS * 1000) / LATENCY_BENCH_PERIOD_US;
+	static Histogram<64> irqHist(100);
+	static Histogram<64> wakeHist(1000);
+	LatencyStats irqStats, wakeStats;
+	uint32_t missed = 0;
+	uint32_t frames = 0;
+	STAT_COUNTER lastRecv = lwip_stats.link.recv;
+	UBaseType_t priority = uxTaskPriorityGet(NULL);
+
+	if (underLoad) {
+		waitForLoad();
+		lastRecv = lwip_stats.link.recv;
+	}
+
+	benchTask = xTaskGetCurrentTaskHandle();
+	vTaskPrioritySet(NULL, configMAX_PRIORITIES - 1);
+
+	startTimer();
+
+	for (uint32_t window = 0; window < LATENCY_BENCH_WINDOWS; window++) {
+		for (uint32_t i = 0; i < samplesPerWindow; i++) {
+			uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			uint64_t now = benchNow();
+
+			/* More than one pending means we slept through a period and
+			 * only the latest timestamps survived */
+			if (pending > 1)
+				missed += pending - 1;
+
+			irqStats.add(irqLatency);
+			irqHist.add(irqLatency);
+			wakeStats.add((uint32_t)(now - isrEntry));
+			wakeHist.add((uint32_t)(now - isrEntry));
+
+			/* lwIP's counters are only 16 bits, fold them in often
+			 * enough that they can't wrap in between */
+			if ((i % 100) == 0) {
+				STAT_COUNTER recv = lwip_stats.link.recv;
+
+				frames += (STAT_COUNTER)(recv - lastRecv);
+				lastRecv = recv;
+			}
+
+			if (LATENCY_BENCH_COLD_CACHE) {
+				Xil_DCacheFlush();
+				Xil_ICacheInvalidate();
+			}
+		}
+
+		xil_printf("\r\n--- latency window %u (%s): %u ms, period %u us, %u rx frames, %u missed\r\n",
+				window, underLoad ? "network load" : "idle", LATENCY_BENCH_WINDOW_MS, LATENCY_BENCH_PERIOD_US, frames, missed);
+		xil_printf("hot code in %s, %s caches\r\n", OCM_HOT_CODE ? "OCM" : "DDR",
+				LATENCY_BENCH_COLD_CACHE ? "cold" : "warm");
+		irqStats.print("irq -> isr");
+		irqHist.print("irq -> isr");
+		wakeStats.print("isr -> task");
+		wakeHist.print("isr -> task");
+
+		irqStats.reset();
+		irqHist.reset();
+		wakeStats.reset();
+		wakeHist.reset();
+		missed = 0;
+		frames = 0;
+
+		/* Printing took several periods, drop what piled up meanwhile */
+		ulTaskNotifyTake(pdTRUE, 0);
+	}
+
+	stopTimer();
+	ulTaskNotifyTake(pdTRUE, 0);
+	vTaskPrioritySet(NULL, priority);
+}
@@ -0,0 +1,56 @@
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "xil_printf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Benchmarks.h"
+
+/*
+ * Ping-pong between this task and the tcpip thread. Each round trip posts a
+ * callback to the tcpip mailbox, and the callback signals a semaphore this
+ * task is blocked on, so one sample covers a mailbox post/fetch and a
+ * semaphore signal/wait plus two context switches.
+ *
+ * Run it once with LWIP_SYS_ARCH_NOTIFY set to 1 (task notifications) and
+ * once with it set to 0 (FreeRTOS queues) to see the difference.
+ */
+
+#define MBOX_BENCH_ROUNDS 10000
+
+static void pong(void *arg)
+{
+	sys_sem_signal((sys_sem_t *)arg);
+}
+
+void mboxBench(void)
+{
+	sys_sem_t sem;
+	LatencyStats stats;
+
+	if (sys_sem_new(&sem, 0) != ERR_OK) {
+		xil_printf("%s: failed to create semaphore\r\n", __FUNCTION__);
+		return;
+	}
+
+	/* Warm up the caches and the tcpip_msg pool before measuring */
+	for (int i = 0; i < 100; i++) {
+		tcpip_callback(pong, &sem);
+		sys_arch_sem_wait(&sem, 0);
+	}
+
+	for (int i = 0; i < MBOX_BENCH_ROUNDS; i++) {
+		uint64_t start = benchNow();
+
+		tcpip_callback(pong, &sem);
+		sys_arch_sem_wait(&sem, 0);
+
+		stats.add((uint32_t)(benchNow() - start));
+	}
+
+	xil_printf("lwIP sys_arch %s round trip\r\n",
+			LWIP_SYS_ARCH_NOTIFY ? "(task notifications)" : "(queues)");
+	stats.print("  tcpip ping-pong");
+
+	sys_sem_free(&sem);
+}
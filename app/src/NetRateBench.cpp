@@ -0,0 +1,90 @@
+#include <string.h>
+
+#include "lwip/sockets.h"
+#include "lwip/stats.h"
+#include "xil_printf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Benchmarks.h"
+#include "Ocm.h"
+
+/*
+ * UDP receive rate. Datagrams sent to NET_RATE_BENCH_PORT are counted and
+ * thrown away, and every NET_RATE_BENCH_WINDOW_MS the packet and bit rates
+ * are printed along with the frames lwIP dropped at the link layer. Drive
+ * it from a host with something like
+ *
+ *	iperf -u -c <board ip> -p 5001 -b 200M -l 64
+ *
+ * Short datagrams make the per-packet cost (interrupt, BD handling, lwIP
+ * input) dominate, which is what the OCM_HOT_CODE=0/1 builds differ in.
+ *
+ * It needs the network up and never returns, so it runs last.
+ */
+
+#ifndef NET_RATE_BENCH_PORT
+#define NET_RATE_BENCH_PORT 5001
+#endif
+
+#ifndef NET_RATE_BENCH_WINDOW_MS
+#define NET_RATE_BENCH_WINDOW_MS 5000
+#endif
+
+void netRateBench(void)
+{
+	static uint8_t buf[1500];
+	struct sockaddr_in addr;
+	uint64_t windowTicks = ((uint64_t)COUNTS_PER_SECOND * NET_RATE_BENCH_WINDOW_MS) / 1000;
+	uint64_t start;
+	uint32_t packets = 0;
+	uint64_t bytes = 0;
+	STAT_COUNTER lastDrop = lwip_stats.link.drop;
+	int sock;
+
+	if ((sock = lwip_socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+		xil_printf("%s: failed to create socket\r\n", __FUNCTION__);
+		return;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(NET_RATE_BENCH_PORT);
+	addr.sin_addr.s_addr = INADDR_ANY;
+	if (lwip_bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		xil_printf("%s: failed to bind port %u\r\n", __FUNCTION__, NET_RATE_BENCH_PORT);
+		lwip_close(sock);
+		return;
+	}
+
+	xil_printf("UDP rate benchmark on port %u, hot code in %s\r\n", NET_RATE_BENCH_PORT,
+			OCM_HOT_CODE ? "OCM" : "DDR");
+
+	start = benchNow();
+	for (;;) {
+		int n = lwip_recv(sock, buf, sizeof(buf), 0);
+		uint64_t elapsed;
+
+		if (n < 0)
+			continue;
+
+		packets++;
+		bytes += n;
+
+		elapsed = benchNow() - start;
+		if (elapsed >= windowTicks) {
+			uint32_t ms = (uint32_t)((elapsed * 1000) / COUNTS_PER_SECOND);
+			STAT_COUNTER drop = lwip_stats.link.drop;
+
+			xil_printf("udp rx: %u pkt/s, %u kbit/s, %u link drops\r\n",
+					(uint32_t)(((uint64_t)packets * 1000) / ms),
+					(uint32_t)((bytes * 8) / ms),
+					(STAT_COUNTER)(drop - lastDrop));
+
+			lastDrop = drop;
+			packets = 0;
+			bytes = 0;
+			start = benchNow();
+		}
+	}
+}
@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+
+#include "CriticalSection.h"
+#include "Ocm.h"
+
+extern "C" {
+/* From lscript.ld */
+extern uint8_t __ocm_text_start[], __ocm_text_end[], __ocm_text_load[];
+extern uint8_t __ocm_data_start[], __ocm_data_end[], __ocm_data_load[];
+extern uint8_t __ocm_bss_start[], __ocm_bss_end[];
+extern uint8_t __ocm_heap_start[], __ocm_heap_end[];
+
+/* From OcmVectors.S */
+extern uint32_t _ocm_vector_table[];
+}
+
+/* Free part of the heap. Cached allocations grow up from heapLow and
+ * uncached pages down from heapHigh. */
+static uintptr_t heapLow;
+static uintptr_t heapHigh;
+static size_t heapFailures;
+
+void ocmInit(void)
+{
+	uint32_t textSize = __ocm_text_end - __ocm_text_start;
+	uint32_t dataSize = __ocm_data_end - __ocm_data_start;
+
+	memcpy(__ocm_text_start, __ocm_text_load, textSize);
+	memcpy(__ocm_data_start, __ocm_data_load, dataSize);
+	memset(__ocm_bss_start, 0, __ocm_bss_end - __ocm_bss_start);
+
+	/* The code was written through the data cache, push it out and make
+	 * sure the instruction side doesn't hold anything stale */
+	Xil_DCacheFlushRange((INTPTR)__ocm_text_start, textSize);
+	Xil_ICacheInvalidateRange((INTPTR)__ocm_text_start, textSize);
+
+	heapLow = (uintptr_t)__ocm_heap_start;
+	heapHigh = (uintptr_t)__ocm_heap_end;
+
+	xil_printf("OCM: %u bytes of code, %u bytes of data, %u bytes free\r\n", textSize,
+			dataSize + (uint32_t)(__ocm_bss_end - __ocm_bss_start),
+			(uint32_t)(heapHigh - heapLow));
+}
+
+void ocmInstallVectors(void)
+{
+	mtcp(XREG_CP15_VEC_BASE_ADDR, (uint32_t)_ocm_vector_table);
+	dsb();
+	isb();
+}
+
+void *ocmAlloc(size_t size, size_t align)
+{
+	IsrLock lock;
+	uintptr_t ptr = (heapLow + align - 1) & ~(uintptr_t)(align - 1);
+
+	if (ptr > heapHigh || size > heapHigh - ptr) {
+		heapFailures++;
+		return nullptr;
+	}
+
+	heapLow = ptr + size;
+	return reinterpret_cast<void *>(ptr);
+}
+
+void *ocmAllocUncached(size_t size)
+{
+	uintptr_t ptr;
+
+	size = (size + XIL_MMU_PAGE_SIZE - 1) & ~(size_t)(XIL_MMU_PAGE_SIZE - 1);
+
+	{
+		IsrLock lock;
+		uintptr_t top = heapHigh & ~(uintptr_t)(XIL_MMU_PAGE_SIZE - 1);
+
+		if (size == 0 || top < heapLow || size > top - heapLow) {
+			heapFailures++;
+			return nullptr;
+		}
+
+		ptr = top - size;
+		heapHigh = ptr;
+	}
+
+	/* The pages are gone from the heap either way, but if the MMU ran
+	 * out of second-level tables they are still cacheable and no use for
+	 * DMA */
+	if (Xil_SetTlbAttributesRange((INTPTR)ptr, size, NORM_NONCACHE) != XST_SUCCESS) {
+		xil_printf("%s: could not remap %u bytes at 0x%08x\r\n", __FUNCTION__,
+				(uint32_t)size, (uint32_t)ptr);
+		heapFailures++;
+		return nullptr;
+	}
+
+	return reinterpret_cast<void *>(ptr);
+}
+
+size_t ocmAvailable(void)
+{
+	IsrLock lock;
+
+	return heapHigh - heapLow;
+}
+
+size_t ocmFailures(void)
+{
+	return heapFailures;
+}
@@ -0,0 +1,72 @@
+#ifndef OCM_H
+#define OCM_H
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+/*
+ * On-chip memory placement. The OCM answers in a fraction of the time DDR
+ * takes on a cache miss, and nothing else uses it once the FSBL has handed
+ * over. lscript.ld links the hot interrupt and network code into OCM_LOW,
+ * along with anything marked with these attributes:
+ *
+ *	OCM_TEXT static void fastIsr(void *)		code
+ *	OCM_DATA static uint32_t table[64] = {...};	initialized data
+ *	OCM_BSS static uint8_t ring[2048];		zeroed data
+ *
+ * With OCM_HOT_CODE=0 OCM_TEXT functions stay in DDR like everything else.
+ */
+
+#ifndef OCM_HOT_CODE
+#define OCM_HOT_CODE 1
+#endif
+
+#define OCM_TEXT	__attribute__ ((section (".ocm.text"), noinline))
+#define OCM_DATA	__attribute__ ((section (".ocm.data")))
+#define OCM_BSS		__attribute__ ((section (".ocm.bss")))
+
+/*
+ * Copies the OCM code and data sections from their load image in DDR and
+ * zeroes .ocm_bss. Must run first thing in main(), before anything that
+ * lives in OCM can be called.
+ */
+void ocmInit(void);
+
+/*
+ * Points VBAR at the vector table in OCM. The FreeRTOS port installs its own
+ * table in DDR when the scheduler starts, so this is called from the first
+ * task.
+ */
+void ocmInstallVectors(void);
+
+/*
+ * Scratchpad allocator over what is left of OCM_LOW after the sections
+ * above (see .ocm_heap in lscript.ld), for small structures on the hot
+ * path: descriptor rings, per-packet metadata, rings between tasks. There
+ * is no free, so allocate once at startup and keep the memory for the life
+ * of the program.
+ *
+ * ocmAlloc() returns cacheable memory aligned to align (a power of two),
+ * or nullptr once the region is used up. It can be called from an ISR.
+ *
+ * ocmAllocUncached() returns whole 4 KB pages from the top of the region,
+ * remapped as normal non-cacheable memory so that a DMA master sees the
+ * CPU's writes without cache maintenance. Remapping flushes the caches and
+ * edits the page tables, so call it from a task during startup only.
+ */
+void *ocmAlloc(size_t size, size_t align = 8);
+void *ocmAllocUncached(size_t size);
+
+template <typename T, typename... Args>
+T *ocmCreate(Args &&... args)
+{
+	void *ptr = ocmAlloc(sizeof(T), alignof(T));
+	return ptr ? new (ptr) T(std::forward<Args>(args)...) : nullptr;
+}
+
+/* Bytes still free, and allocations that did not fit */
+size_t ocmAvailable(void);
+size_t ocmFailures(void);
+
+#endif /* OCM_H */
@@ -0,0 +1,154 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+#include "FreeRTOS.h"
+#include "CriticalSection.h"
+
+/*
+ * Fixed-size object pool. Storage for N objects of type T lives inside the
+ * pool, so allocate() and release() are a free-list pop and push under Lock,
+ * with no trip through newlib malloc (which isn't reentrant in this build).
+ *
+ * Slots are handed out from the never-used tail before the free list is
+ * consulted, so the pool needs no construction-time setup and a static pool
+ * is constant-initialized into .bss.
+ */
+template <typename T, size_t N, typename Lock = TaskLock>
+class ObjectPool {
+public:
+	constexpr ObjectPool() : mSlots{}, mFree(nullptr), mUnused(0),
+		mInUse(0), mHighWater(0), mFailures(0) {}
+
+	ObjectPool(const ObjectPool &) = delete;
+	ObjectPool &operator=(const ObjectPool &) = delete;
+
+	/* Raw storage for one T, or nullptr when the pool is exhausted */
+	void *allocate(void)
+	{
+		Lock lock;
+		Slot *slot = mFree;
+
+		if (slot) {
+			mFree = slot->next;
+		} else if (mUnused < N) {
+			slot = &mSlots[mUnused++];
+		} else {
+			mFailures++;
+			return nullptr;
+		}
+
+		if (++mInUse > mHighWater) {
+			mHighWater = mInUse;
+		}
+
+		return slot->storage;
+	}
+
+	void release(void *ptr)
+	{
+		if (!ptr) {
+			return;
+		}
+
+		configASSERT(contains(ptr));
+
+		Slot *slot = reinterpret_cast<Slot *>(ptr);
+		Lock lock;
+
+		slot->next = mFree;
+		mFree = slot;
+		mInUse--;
+	}
+
+	template <typename... Args>
+	T *create(Args &&... args)
+	{
+		void *ptr = allocate();
+		return ptr ? new (ptr) T(std::forward<Args>(args)...) : nullptr;
+	}
+
+	void destroy(T *obj)
+	{
+		if (obj) {
+			obj->~T();
+			release(obj);
+		}
+	}
+
+	bool contains(const void *ptr) const
+	{
+		const unsigned char *p = static_cast<const unsigned char *>(ptr);
+		const unsigned char *base = reinterpret_cast<const unsigned char *>(mSlots);
+
+		return p >= base && p < base + sizeof(mSlots) &&
+			((size_t)(p - base) % sizeof(Slot)) == 0;
+	}
+
+	size_t capacity(void) const { return N; }
+	size_t inUse(void) const { return mInUse; }
+	size_t highWater(void) const { return mHighWater; }
+	size_t failures(void) const { return mFailures; }
+
+private:
+	union Slot {
+		Slot *next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	Slot mSlots[N];
+	Slot *mFree;
+	size_t mUnused;
+	size_t mInUse;
+	size_t mHighWater;
+	size_t mFailures;
+};
+
+/* Pool that can be allocated from and released to inside an ISR */
+template <typename T, size_t N>
+using IsrObjectPool = ObjectPool<T, N, IsrLock>;
+
+/* Backing pool for PoolAllocated. Kept out of that class so T only has to be
+ * complete once operator new is actually used, not when it is derived from. */
+template <typename T, size_t N, typename Lock>
+struct PoolStorage {
+	static ObjectPool<T, N, Lock> pool;
+};
+
+template <typename T, size_t N, typename Lock>
+ObjectPool<T, N, Lock> PoolStorage<T, N, Lock>::pool;
+
+/*
+ * Give a class its own pool by deriving from this:
+ *
+ *     class Connection : public PoolAllocated<Connection, 8> { ... };
+ *
+ * after which `new Connection(...)` and `delete conn` use the pool. The
+ * class-level operator new is noexcept, so `new` evaluates to nullptr rather
+ * than throwing when all N are in use.
+ */
+template <typename T, size_t N, typename Lock = TaskLock>
+class PoolAllocated {
+public:
+	static void *operator new(size_t size) noexcept
+	{
+		/* A derived class bigger than T won't fit in the slots */
+		configASSERT(size <= sizeof(T));
+		return PoolStorage<T, N, Lock>::pool.allocate();
+	}
+
+	static void operator delete(void *ptr) noexcept
+	{
+		PoolStorage<T, N, Lock>::pool.release(ptr);
+	}
+
+	static const ObjectPool<T, N, Lock> &pool(void)
+	{
+		return PoolStorage<T, N, Lock>::pool;
+	}
+};
+
+#endif /* POOL_H */
@@ -0,0 +1,194 @@
+#include <string.h>
+
+#include "xil_printf.h"
+#include "xil_io.h"
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#include "xpm_counter.h"
+#include "xl2cc.h"
+#include "xl2cc_counter.h"
+
+#include "CriticalSection.h"
+#include "Profile.h"
+
+#ifdef PROFILE_ZONES
+
+/* PMU events, one per counter */
+enum {
+	PROFILE_PMU_CYCLES,
+	PROFILE_PMU_INSTRUCTIONS,
+	PROFILE_PMU_L1D_REFILLS,
+	PROFILE_PMU_L1I_REFILLS,
+	PROFILE_PMU_EVENTS
+};
+
+static const u32 pmuEvents[PROFILE_PMU_EVENTS] = {
+	XPM_EVENT_CLOCKCYCLES,
+	XPM_EVENT_INSTRRENAME,
+	XPM_EVENT_DATA_CACHEREFILL,
+	XPM_EVENT_INSRFETCH_CACHEREFILL,
+};
+
+struct ProfileStats {
+	const char *name;
+	uint32_t calls;
+	uint32_t maxCycles;
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t l1dRefills;
+	uint64_t l1iRefills;
+	uint64_t l2ReadHits;
+	uint64_t l2Reads;
+};
+
+enum ProfileState {
+	PROFILE_UNINITIALIZED,
+	PROFILE_RUNNING,
+	PROFILE_FAILED,
+};
+
+static ProfileStats zones[PROFILE_MAX_ZONES];
+static uint32_t zoneCount;
+static uint32_t droppedZones;
+static ProfileState state = PROFILE_UNINITIALIZED;
+static u32 pmuCounter[PROFILE_PMU_EVENTS];
+
+/* Called with interrupts masked */
+static bool profileInit(void)
+{
+	u32 pmcr;
+
+	/* Enable the PMU, then claim a counter per event */
+	pmcr = mfcp(XREG_CP15_PERF_MONITOR_CTRL);
+	mtcp(XREG_CP15_PERF_MONITOR_CTRL, pmcr | 0x1U);
+	isb();
+
+	for (int i = 0; i < PROFILE_PMU_EVENTS; i++) {
+		pmuCounter[i] = Xpm_SetUpAnEvent(pmuEvents[i]);
+		if (pmuCounter[i] == XPM_NO_COUNTERS_AVAILABLE) {
+			xil_printf("%s: no free PMU counter, profiling disabled\r\n", __FUNCTION__);
+			return false;
+		}
+	}
+
+	XL2cc_EventCtrInit(XL2CC_DRHIT, XL2CC_DRREQ);
+	XL2cc_EventCtrStart();
+
+	return true;
+}
+
+void profileRead(ProfileCounters *counters)
+{
+	/* The PMU counters are read through a shared select register, so an
+	 * interrupt handler must not open a zone halfway through */
+	IsrLock lock;
+
+	Xpm_GetEventCounter(pmuCounter[PROFILE_PMU_CYCLES], &counters->cycles);
+	Xpm_GetEventCounter(pmuCounter[PROFILE_PMU_INSTRUCTIONS], &counters->instructions);
+	Xpm_GetEventCounter(pmuCounter[PROFILE_PMU_L1D_REFILLS], &counters->l1dRefills);
+	Xpm_GetEventCounter(pmuCounter[PROFILE_PMU_L1I_REFILLS], &counters->l1iRefills);
+	counters->l2ReadHits = Xil_In32(XPS_L2CC_BASEADDR + XPS_L2CC_EVNT_CNT0_VAL_OFFSET);
+	counters->l2Reads = Xil_In32(XPS_L2CC_BASEADDR + XPS_L2CC_EVNT_CNT1_VAL_OFFSET);
+}
+
+/*
+ * Zone names are nearly always string literals, so try pointer equality
+ * first and only compare strings for a name first seen from another file.
+ */
+ProfileStats *profileLookup(const char *name)
+{
+	IsrLock lock;
+	uint32_t i;
+
+	if (state == PROFILE_UNINITIALIZED)
+		state = profileInit() ? PROFILE_RUNNING : PROFILE_FAILED;
+	if (state != PROFILE_RUNNING)
+		return nullptr;
+
+	for (i = 0; i < zoneCount; i++) {
+		if (zones[i].name == name)
+			return &zones[i];
+	}
+	for (i = 0; i < zoneCount; i++) {
+		if (strcmp(zones[i].name, name) == 0)
+			return &zones[i];
+	}
+
+	if (zoneCount == PROFILE_MAX_ZONES) {
+		droppedZones++;
+		return nullptr;
+	}
+
+	zones[zoneCount].name = name;
+	return &zones[zoneCount++];
+}
+
+void profileAdd(ProfileStats *stats, const ProfileCounters &start)
+{
+	ProfileCounters end;
+	uint32_t cycles;
+
+	profileRead(&end);
+	cycles = end.cycles - start.cycles;
+
+	IsrLock lock;
+
+	stats->calls++;
+	stats->cycles += cycles;
+	if (cycles > stats->maxCycles)
+		stats->maxCycles = cycles;
+	stats->instructions += end.instructions - start.instructions;
+	stats->l1dRefills += end.l1dRefills - start.l1dRefills;
+	stats->l1iRefills += end.l1iRefills - start.l1iRefills;
+	stats->l2ReadHits += end.l2ReadHits - start.l2ReadHits;
+	stats->l2Reads += end.l2Reads - start.l2Reads;
+}
+
+void profileReset(void)
+{
+	IsrLock lock;
+
+	for (uint32_t i = 0; i < zoneCount; i++) {
+		const char *name = zones[i].name;
+
+		memset(&zones[i], 0, sizeof(zones[i]));
+		zones[i].name = name;
+	}
+	droppedZones = 0;
+}
+
+void profileDump(void)
+{
+	/* Too big for a task stack, and only one task prints the table */
+	static ProfileStats snapshot[PROFILE_MAX_ZONES];
+	uint32_t count;
+
+	{
+		IsrLock lock;
+
+		count = zoneCount;
+		memcpy(snapshot, zones, count * sizeof(zones[0]));
+	}
+
+	xil_printf("%-20s %8s %10s %10s %6s %8s %8s %6s\r\n", "zone", "calls",
+			"cyc/call", "max cyc", "IPC", "L1D/call", "L1I/call", "L2 hit");
+	for (uint32_t i = 0; i < count; i++) {
+		const ProfileStats &z = snapshot[i];
+		uint32_t ipc100, l2Permille;
+
+		if (z.calls == 0)
+			continue;
+
+		ipc100 = z.cycles ? (uint32_t)((z.instructions * 100) / z.cycles) : 0;
+		l2Permille = z.l2Reads ? (uint32_t)((z.l2ReadHits * 1000) / z.l2Reads) : 0;
+		xil_printf("%-20s %8u %10u %10u %3u.%02u %8u %8u %3u.%u%%\r\n", z.name, z.calls,
+				(uint32_t)(z.cycles / z.calls), z.maxCycles,
+				ipc100 / 100, ipc100 % 100,
+				(uint32_t)(z.l1dRefills / z.calls), (uint32_t)(z.l1iRefills / z.calls),
+				l2Permille / 10, l2Permille % 10);
+	}
+	if (droppedZones)
+		xil_printf("%u zone calls not recorded, raise PROFILE_MAX_ZONES\r\n", droppedZones);
+}
+
+#endif /* PROFILE_ZONES */
@@ -0,0 +1,88 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/*
+ * Scoped profiling zones over the Cortex-A9 PMU and the PL310 event counters.
+ *
+ *	void rxPath(void)
+ *	{
+ *		ProfileZone zone("rx_path");
+ *		...
+ *	}
+ *
+ * Every zone with the same name adds to one entry: number of calls, CPU
+ * cycles, instructions, L1 data and instruction cache refills, and L2 data
+ * read requests and hits. profileDump() prints the table and profileReset()
+ * clears it. Zones work in tasks and in interrupt handlers.
+ *
+ * Counts are inclusive. A nested zone is counted in its parent as well, and
+ * a task zone also counts any interrupts taken while it was open. The L2
+ * counters see every master behind the PL310, not just this CPU.
+ *
+ * Zones only do anything when the app is built with PROFILE_ZONES
+ * (make PROFILE_ZONES=1). Otherwise ProfileZone is empty and compiles away.
+ */
+
+#ifndef PROFILE_MAX_ZONES
+#define PROFILE_MAX_ZONES 32
+#endif
+
+/* Snapshot of the free-running counters */
+struct ProfileCounters {
+	uint32_t cycles;
+	uint32_t instructions;
+	uint32_t l1dRefills;
+	uint32_t l1iRefills;
+	uint32_t l2ReadHits;
+	uint32_t l2Reads;
+};
+
+struct ProfileStats;
+
+#ifdef PROFILE_ZONES
+
+void profileRead(ProfileCounters *counters);
+ProfileStats *profileLookup(const char *name);
+void profileAdd(ProfileStats *stats, const ProfileCounters &start);
+void profileDump(void);
+void profileReset(void);
+
+class ProfileZone {
+public:
+	ProfileZone(const char *name) : mStats(profileLookup(name))
+	{
+		profileRead(&mStart);
+	}
+
+	~ProfileZone()
+	{
+		if (mStats)
+			profileAdd(mStats, mStart);
+	}
+
+	ProfileZone(const ProfileZone &) = delete;
+	ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+	ProfileStats *mStats;
+	ProfileCounters mStart;
+};
+
+#else
+
+static inline void profileDump(void) {}
+static inline void profileReset(void) {}
+
+class ProfileZone {
+public:
+	ProfileZone(const char *) {}
+
+	ProfileZone(const ProfileZone &) = delete;
+	ProfileZone &operator=(const ProfileZone &) = delete;
+};
+
+#endif /* PROFILE_ZONES */
+
+#endif /* PROFILE_H */
@@ -0,0 +1,122 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Single-producer, single-consumer byte ring. The producer only moves mHead
+ * and the consumer only moves mTail, each publishing with a release store
+ * after touching the data, so one side can be an interrupt handler and the
+ * other a task without any lock between them. Several producers (or
+ * consumers) must serialize among themselves.
+ *
+ * Besides copying with write() and read(), either side can work in place:
+ * writeRegion()/commitWrite() hand out the contiguous free space at the
+ * head, for a driver to receive straight into, and readRegion()/commitRead()
+ * the contiguous data at the tail, for a driver to send straight from.
+ *
+ * Size must be a power of two. The indices run freely and wrap at 2^32.
+ */
+template <size_t Size>
+class ByteRing {
+	static_assert((Size & (Size - 1)) == 0, "ByteRing size must be a power of two");
+
+public:
+	constexpr ByteRing() : mHead(0), mTail(0), mBuf{} {}
+
+	ByteRing(const ByteRing &) = delete;
+	ByteRing &operator=(const ByteRing &) = delete;
+
+	size_t capacity(void) const { return Size; }
+
+	size_t used(void) const
+	{
+		return __atomic_load_n(&mHead, __ATOMIC_ACQUIRE) - __atomic_load_n(&mTail, __ATOMIC_ACQUIRE);
+	}
+
+	size_t space(void) const { return Size - used(); }
+
+	/* Producer side */
+
+	size_t writeRegion(uint8_t **ptr)
+	{
+		uint32_t head = mHead;
+		uint32_t free = Size - (head - __atomic_load_n(&mTail, __ATOMIC_ACQUIRE));
+		uint32_t toEnd = Size - (head & (Size - 1));
+
+		*ptr = &mBuf[head & (Size - 1)];
+		return free < toEnd ? free : toEnd;
+	}
+
+	void commitWrite(size_t len)
+	{
+		__atomic_store_n(&mHead, mHead + (uint32_t)len, __ATOMIC_RELEASE);
+	}
+
+	/* Copies as much of data as fits, returns how much that was */
+	size_t write(const void *data, size_t len)
+	{
+		const uint8_t *src = static_cast<const uint8_t *>(data);
+		size_t done = 0;
+
+		while (done < len) {
+			uint8_t *dst;
+			size_t n = writeRegion(&dst);
+
+			if (n == 0)
+				break;
+			if (n > len - done)
+				n = len - done;
+			memcpy(dst, src + done, n);
+			commitWrite(n);
+			done += n;
+		}
+		return done;
+	}
+
+	/* Consumer side */
+
+	size_t readRegion(const uint8_t **ptr) const
+	{
+		uint32_t tail = mTail;
+		uint32_t avail = __atomic_load_n(&mHead, __ATOMIC_ACQUIRE) - tail;
+		uint32_t toEnd = Size - (tail & (Size - 1));
+
+		*ptr = &mBuf[tail & (Size - 1)];
+		return avail < toEnd ? avail : toEnd;
+	}
+
+	void commitRead(size_t len)
+	{
+		__atomic_store_n(&mTail, mTail + (uint32_t)len, __ATOMIC_RELEASE);
+	}
+
+	size_t read(void *data, size_t len)
+	{
+		uint8_t *dst = static_cast<uint8_t *>(data);
+		size_t done = 0;
+
+		while (done < len) {
+			const uint8_t *src;
+			size_t n = readRegion(&src);
+
+			if (n == 0)
+				break;
+			if (n > len - done)
+				n = len - done;
+			memcpy(dst + done, src, n);
+			commitRead(n);
+			done += n;
+		}
+		return done;
+	}
+
+private:
+	uint32_t mHead;
+	uint32_t mTail;
+	uint8_t mBuf[Size];
+};
+
+#endif /* RING_H */
@@ -3,6 +3,47 @@
 
 #include "lwip/sockets.h"
 
+#include "Pool.h"
+
+/* Client connections open at once across all servers: the echo
+ * application's data, control and telnet ports plus the update service */
+#define STE_TCP_MAX_CONNECTIONS 4
+
+/*
+ * One accepted client. Connections come from a fixed pool rather than the
+ * heap, so acceptConnection() and delete stay O(1) and off newlib malloc.
+ * Deleting a connection closes its socket.
+ */
+class SteTcpConnection : public PoolAllocated<SteTcpConnection, STE_TCP_MAX_CONNECTIONS> {
+public:
+    SteTcpConnection(int connFd, const struct sockaddr_in &addr) : mConnFd(connFd), mAddr(addr) {}
+
+    ~SteTcpConnection()
+    {
+        xil_printf("Closing TCP connection\n\r");
+        lwip_close(mConnFd);
+    }
+
+    SteTcpConnection(const SteTcpConnection &) = delete;
+    SteTcpConnection &operator=(const SteTcpConnection &) = delete;
+
+    int32_t tx(uint8_t *buff, size_t len)
+    {
+        return lwip_send(mConnFd, buff, len, 0);
+    }
+
+    int32_t rx(uint8_t *buff, size_t len)
+    {
+        return lwip_recv(mConnFd, buff, len, 0);
+    }
+
+    const struct sockaddr_in &address(void) const { return mAddr; }
+
+private:
+    int mConnFd;
+    struct sockaddr_in mAddr;
+};
+
 class SteTcpServer {
 public:
     enum ErrorCode {
@@ -40,39 +81,28 @@ public:
         return PASS;
     }
 
-    bool acceptConnection(void)
+    /* Waits for the next client. Returns nullptr if the accept fails or
+     * every connection is in use, in which case the client is turned away. */
+    SteTcpConnection *acceptConnection(void)
     {
+        struct sockaddr_in clientaddr;
         socklen_t clientAddrlen = sizeof(clientaddr);
+        SteTcpConnection *conn;
+        int connFd;
 
-        if ((mConnFd = lwip_accept(mSockFd, (struct sockaddr *)&clientaddr, &clientAddrlen)) == -1) {
+        if ((connFd = lwip_accept(mSockFd, (struct sockaddr *)&clientaddr, &clientAddrlen)) == -1) {
             xil_printf("Error on socket accept\n\r");
-            return -1;
+            return nullptr;
         }
 
-        xil_printf("TCP Client connected from %s: %d\n\r", inet_ntoa(clientaddr.sin_addr), ntohs(clientaddr.sin_port));
-        return true;
-    }
-
-    int32_t tx(uint8_t *buff, size_t len)
-    {
-        if (mConnFd) {
-            return lwip_send(mConnFd, buff, len, 0);
-        } else {
-            xil_printf("Trying to send to disconnected client\n\r");
-            return -1;
+        if ((conn = new SteTcpConnection(connFd, clientaddr)) == nullptr) {
+            xil_printf("Too many TCP connections, refusing %s\n\r", inet_ntoa(clientaddr.sin_addr));
+            lwip_close(connFd);
+            return nullptr;
         }
-    }
 
-    int32_t rx(uint8_t *buff, size_t len)
-    {
-        return lwip_recv(mConnFd, buff, len, 0);
-    }
-
-    void closeClient(void)
-    {
-        xil_printf("Closing TCP connection\n\r");
-        lwip_close(mConnFd);
-        mConnFd = 0;
+        xil_printf("TCP Client connected from %s: %d\n\r", inet_ntoa(clientaddr.sin_addr), ntohs(clientaddr.sin_port));
+        return conn;
     }
 
     void closeServer(void)
@@ -84,9 +114,7 @@ public:
 
 private:
 	int mSockFd = 0;
-    int mConnFd = 0;
-	int size;
-	struct sockaddr_in servaddr, clientaddr;
+	struct sockaddr_in servaddr;
 };
 
 #endif /* TCP_SERVER_H */
\ No newline at end of file
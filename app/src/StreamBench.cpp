@@ -0,0 +1,346 @@
+#include <stddef.h>
+
+#include "xil_printf.h"
+#include "xil_io.h"
+#include "xil_cache.h"
+#include "xil_cache_l.h"
+#include "xil_mmu.h"
+#include "xl2cc.h"
+#include "xpseudo_asm.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Benchmarks.h"
+#include "Ocm.h"
+
+/*
+ * STREAM-style bandwidth and pointer-chasing latency for each place the app
+ * can keep its buffers:
+ *
+ *   ocm          OCM_LOW from ocmAlloc(). The CPU reaches the OCM through
+ *                the SCU, so only the L1 caches it
+ *   ddr          cacheable DDR, arrays 4x the size of the L2
+ *   ddr uncached the same arrays remapped as normal non-cacheable
+ *
+ * copy, scale, add and triad are the four STREAM kernels on doubles, best
+ * of STREAM_BENCH_TIMES runs, counting the bytes read and written as STREAM
+ * does. Latency follows a random cyclic chain of pointers, one per cache
+ * line, across all three arrays, so every load depends on the previous one
+ * and the prefetchers get nothing to work with.
+ *
+ * The whole set runs once per PL310 configuration below, so the effect of
+ * L2 prefetch, double linefill and early write responses shows up next to
+ * the default. The L2 is cleaned and disabled to change them, and the boot
+ * configuration is put back at the end. Nothing else may run while the L2
+ * is off or a page table entry is changing, so those steps run in a
+ * QuietSection.
+ */
+
+#define STREAM_BENCH_DDR_BYTES		(2 * 1024 * 1024)
+#define STREAM_BENCH_OCM_BYTES		(16 * 1024)
+#define STREAM_BENCH_TIMES			5
+#define STREAM_BENCH_CHASE_STEPS	(256 * 1024)
+#define STREAM_BENCH_LINE			32
+
+#define DDR_ELEMENTS	(STREAM_BENCH_DDR_BYTES / sizeof(double))
+
+/* Each array starts on a 1 MB section, so remapping them uncached does not
+ * need second-level page tables. Their contents are written before use. */
+static double ddrA[DDR_ELEMENTS] __attribute__ ((aligned (0x100000), section (".noinit")));
+static double ddrB[DDR_ELEMENTS] __attribute__ ((aligned (0x100000), section (".noinit")));
+static double ddrC[DDR_ELEMENTS] __attribute__ ((aligned (0x100000), section (".noinit")));
+
+struct StreamRegion {
+	const char *name;
+	double *a;
+	double *b;
+	double *c;
+	size_t n;
+};
+
+struct L2Config {
+	const char *name;
+	u32 auxSet;
+	u32 auxClear;
+	u32 prefetchSet;
+	u32 prefetchClear;
+};
+
+static const L2Config l2Configs[] = {
+	{ "boot default", 0, 0, 0, 0 },
+	{ "no L2 prefetch", 0, XPS_L2CC_AUX_IPFE_MASK | XPS_L2CC_AUX_DPFE_MASK,
+			0, XPS_L2CC_PREFETCH_IPFE_MASK | XPS_L2CC_PREFETCH_DPFE_MASK },
+	{ "double linefill", 0, 0, XPS_L2CC_PREFETCH_DLE_MASK, 0 },
+	{ "no early BRESP", 0, XPS_L2CC_AUX_EBRESPE_MASK, 0, 0 },
+	{ "all, offset 7", XPS_L2CC_AUX_EBRESPE_MASK | XPS_L2CC_AUX_IPFE_MASK | XPS_L2CC_AUX_DPFE_MASK,
+			0, XPS_L2CC_PREFETCH_DLE_MASK | XPS_L2CC_PREFETCH_IPFE_MASK |
+			XPS_L2CC_PREFETCH_DPFE_MASK | 7, XPS_L2CC_PREFETCH_OFFSET_MASK },
+};
+
+static volatile uintptr_t chaseSink;
+
+/*
+ * Keeps every other task and interrupt handler off the CPU: the scheduler is
+ * suspended and IRQs are masked at the core, not just up to
+ * configMAX_API_CALL_INTERRUPT_PRIORITY. The benchmarks run before the
+ * network is up, so no DMA is going on either.
+ */
+class QuietSection {
+public:
+	QuietSection()
+	{
+		vTaskSuspendAll();
+		mCpsr = mfcpsr();
+		mtcpsr(mCpsr | XREG_CPSR_IRQ_ENABLE);
+	}
+
+	~QuietSection()
+	{
+		mtcpsr(mCpsr);
+		(void)xTaskResumeAll();
+	}
+
+	QuietSection(const QuietSection &) = delete;
+	QuietSection &operator=(const QuietSection &) = delete;
+
+private:
+	u32 mCpsr;
+};
+
+/*
+ * The auxiliary control register can only be written with the L2 disabled.
+ * Push everything out first so nothing dirty is lost, and invalidate again
+ * before turning it back on, if it was on.
+ */
+static void l2Configure(u32 aux, u32 prefetch, u32 control)
+{
+	QuietSection quiet;
+
+	Xil_L1DCacheFlush();
+	Xil_L2CacheDisable();
+	Xil_Out32(XPS_L2CC_BASEADDR + XPS_L2CC_AUX_CNTRL_OFFSET, aux);
+	Xil_Out32(XPS_L2CC_BASEADDR + XPS_L2CC_PREFETCH_CTRL_OFFSET, prefetch);
+	Xil_L2CacheInvalidate();
+	Xil_Out32(XPS_L2CC_BASEADDR + XPS_L2CC_CNTRL_OFFSET, control);
+	Xil_Out32(XPS_L2CC_BASEADDR + XPS_L2CC_CACHE_SYNC_OFFSET, 0x0U);
+	dsb();
+}
+
+/* The arrays are whole 1 MB sections, so this never needs a second-level
+ * table, and NORM_WB_CACHE is what translation_table.S maps DDR with */
+static void ddrRemap(u32 attrib)
+{
+	QuietSection quiet;
+
+	Xil_SetTlbAttributesRange((INTPTR)ddrA, sizeof(ddrA), attrib);
+	Xil_SetTlbAttributesRange((INTPTR)ddrB, sizeof(ddrB), attrib);
+	Xil_SetTlbAttributesRange((INTPTR)ddrC, sizeof(ddrC), attrib);
+}
+
+static void __attribute__ ((noinline)) streamCopy(double *c, const double *a, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		c[i] = a[i];
+}
+
+static void __attribute__ ((noinline)) streamScale(double *b, const double *c, double s, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		b[i] = s * c[i];
+}
+
+static void __attribute__ ((noinline)) streamAdd(double *c, const double *a, const double *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		c[i] = a[i] + b[i];
+}
+
+static void __attribute__ ((noinline)) streamTriad(double *a, const double *b, const double *c,
+		double s, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		a[i] = b[i] + s * c[i];
+}
+
+static uint32_t mbPerSecond(uint64_t bytes, uint64_t ticks)
+{
+	return ticks ? (uint32_t)((bytes * COUNTS_PER_SECOND) / ticks / (1024 * 1024)) : 0;
+}
+
+/* Best of STREAM_BENCH_TIMES, in MB/s, for bandwidth[copy, scale, add, triad] */
+static void runStream(const StreamRegion &r, uint32_t bandwidth[4])
+{
+	const double scalar = 3.0;
+	uint64_t best[4] = { UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX };
+	uint64_t start, ticks;
+
+	for (size_t i = 0; i < r.n; i++) {
+		r.a[i] = 1.0;
+		r.b[i] = 2.0;
+		r.c[i] = 0.0;
+	}
+
+	for (int k = 0; k < STREAM_BENCH_TIMES; k++) {
+		start = benchNow();
+		streamCopy(r.c, r.a, r.n);
+		ticks = benchNow() - start;
+		if (ticks < best[0])
+			best[0] = ticks;
+
+		start = benchNow();
+		streamScale(r.b, r.c, scalar, r.n);
+		ticks = benchNow() - start;
+		if (ticks < best[1])
+			best[1] = ticks;
+
+		start = benchNow();
+		streamAdd(r.c, r.a, r.b, r.n);
+		ticks = benchNow() - start;
+		if (ticks < best[2])
+			best[2] = ticks;
+
+		start = benchNow();
+		streamTriad(r.a, r.b, r.c, scalar, r.n);
+		ticks = benchNow() - start;
+		if (ticks < best[3])
+			best[3] = ticks;
+	}
+
+	bandwidth[0] = mbPerSecond(2 * sizeof(double) * r.n, best[0]);
+	bandwidth[1] = mbPerSecond(2 * sizeof(double) * r.n, best[1]);
+	bandwidth[2] = mbPerSecond(3 * sizeof(double) * r.n, best[2]);
+	bandwidth[3] = mbPerSecond(3 * sizeof(double) * r.n, best[3]);
+}
+
+static uintptr_t *chainSlot(double *const arrays[3], uint32_t perArray, uint32_t line)
+{
+	return (uintptr_t *)((uint8_t *)arrays[line / perArray] + (line % perArray) * STREAM_BENCH_LINE);
+}
+
+/*
+ * Links one pointer per cache line of the three arrays into a single random
+ * cycle (Sattolo's shuffle). The first word of each line holds its slot in
+ * the permutation while shuffling, and is then turned into the address of
+ * the next line.
+ */
+static uintptr_t *buildChain(const StreamRegion &r, uint32_t *lines)
+{
+	const uint32_t perArray = (r.n * sizeof(double)) / STREAM_BENCH_LINE;
+	double *const arrays[3] = { r.a, r.b, r.c };
+	uint32_t seed = 0x2545F491;
+
+	*lines = 3 * perArray;
+
+	for (uint32_t i = 0; i < *lines; i++)
+		*chainSlot(arrays, perArray, i) = i;
+
+	for (uint32_t i = *lines - 1; i > 0; i--) {
+		uintptr_t *a = chainSlot(arrays, perArray, i);
+		uintptr_t *b;
+		uintptr_t tmp;
+
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		b = chainSlot(arrays, perArray, seed % i);
+
+		tmp = *a;
+		*a = *b;
+		*b = tmp;
+	}
+
+	for (uint32_t i = 0; i < *lines; i++) {
+		uintptr_t *slot = chainSlot(arrays, perArray, i);
+
+		*slot = (uintptr_t)chainSlot(arrays, perArray, *slot);
+	}
+
+	return (uintptr_t *)r.a;
+}
+
+/* Average load-to-use latency in tenths of a nanosecond */
+static uint32_t runChase(const StreamRegion &r)
+{
+	uintptr_t *p;
+	uint32_t lines;
+	uint64_t start, ticks;
+
+	p = buildChain(r, &lines);
+
+	/* One lap to settle the TLB and whatever fits in the caches */
+	for (uint32_t i = 0; i < lines; i++)
+		p = (uintptr_t *)*p;
+
+	start = benchNow();
+	for (uint32_t i = 0; i < STREAM_BENCH_CHASE_STEPS; i += 8) {
+		p = (uintptr_t *)*p;
+		p = (uintptr_t *)*p;
+		p = (uintptr_t *)*p;
+		p = (uintptr_t *)*p;
+		p = (uintptr_t *)*p;
+		p = (uintptr_t *)*p;
+		p = (uintptr_t *)*p;
+		p = (uintptr_t *)*p;
+	}
+	ticks = benchNow() - start;
+
+	chaseSink = (uintptr_t)p;
+
+	return (uint32_t)((ticks * 10000000000ull) / COUNTS_PER_SECOND / STREAM_BENCH_CHASE_STEPS);
+}
+
+static void runRegion(const StreamRegion &r)
+{
+	uint32_t bandwidth[4];
+	uint32_t latency;
+
+	runStream(r, bandwidth);
+	latency = runChase(r);
+
+	xil_printf("  %-14s %8u %8u %8u %8u %6u.%u\r\n", r.name, bandwidth[0], bandwidth[1],
+			bandwidth[2], bandwidth[3], latency / 10, latency % 10);
+}
+
+void streamBench(void)
+{
+	const size_t ocmElements = STREAM_BENCH_OCM_BYTES / sizeof(double);
+	double *ocm = (double *)ocmAlloc(3 * STREAM_BENCH_OCM_BYTES, STREAM_BENCH_LINE);
+	StreamRegion ddr = { "ddr", ddrA, ddrB, ddrC, DDR_ELEMENTS };
+	StreamRegion ddrUncached = { "ddr uncached", ddrA, ddrB, ddrC, DDR_ELEMENTS };
+	u32 bootAux = Xil_In32(XPS_L2CC_BASEADDR + XPS_L2CC_AUX_CNTRL_OFFSET);
+	u32 bootPrefetch = Xil_In32(XPS_L2CC_BASEADDR + XPS_L2CC_PREFETCH_CTRL_OFFSET);
+	u32 bootControl = Xil_In32(XPS_L2CC_BASEADDR + XPS_L2CC_CNTRL_OFFSET);
+
+	StreamRegion ocmRegion = { "ocm", nullptr, nullptr, nullptr, ocmElements };
+
+	if (ocm != nullptr) {
+		ocmRegion.a = ocm;
+		ocmRegion.b = ocm + ocmElements;
+		ocmRegion.c = ocm + 2 * ocmElements;
+	} else {
+		xil_printf("%s: no room in OCM, skipping it\r\n", __FUNCTION__);
+	}
+
+	for (const L2Config &cfg : l2Configs) {
+		u32 aux = (bootAux & ~cfg.auxClear) | cfg.auxSet;
+		u32 prefetch = (bootPrefetch & ~cfg.prefetchClear) | cfg.prefetchSet;
+
+		l2Configure(aux, prefetch, XPS_L2CC_ENABLE_MASK);
+
+		xil_printf("Memory bandwidth (MB/s) and latency (ns), L2 %s (aux 0x%08x, prefetch 0x%08x)\r\n",
+				cfg.name, aux, prefetch);
+		xil_printf("  %-14s %8s %8s %8s %8s %8s\r\n", "region", "copy", "scale", "add",
+				"triad", "latency");
+
+		if (ocm != nullptr)
+			runRegion(ocmRegion);
+		runRegion(ddr);
+
+		ddrRemap(NORM_NONCACHE);
+		runRegion(ddrUncached);
+		ddrRemap(NORM_WB_CACHE);
+	}
+
+	/* Back to exactly what boot set up, for the benchmarks and app after */
+	l2Configure(bootAux, bootPrefetch, bootControl);
+}
@@ -0,0 +1,262 @@
+#include <stdint.h>
+
+#include "xparameters.h"
+#include "xuartps.h"
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "CriticalSection.h"
+#include "Ring.h"
+#include "Uart.h"
+
+extern "C" {
+/* From port.c */
+extern volatile uint32_t ulPortInterruptNesting;
+extern volatile uint32_t ulCriticalNesting;
+
+/* Replace the polled versions in libxil */
+void outbyte(char c);
+char inbyte(void);
+}
+
+/* ICCPMR with nothing masked, portUNMASK_VALUE in port.c */
+#define UART_PRIORITY_UNMASKED 0xFFUL
+
+static XUartPs uart;
+static ByteRing<UART_TX_RING_SIZE> txRing;
+static ByteRing<UART_RX_RING_SIZE> rxRing;
+static volatile bool ready;
+
+/* The interrupt handler owns the tail of txRing and the head of rxRing. Task
+ * code only touches those (and the state below) with the interrupt masked. */
+static bool txBusy;
+static size_t txChunk;
+
+/* Bytes land straight in rxRing. When it's full the driver is pointed at
+ * rxScratch instead and whatever arrives there is counted and dropped. */
+static uint8_t rxScratch[16];
+static bool rxDropping;
+static uint32_t rxCredited;
+
+static uint32_t txDropped;
+static uint32_t rxDropped;
+static UartOverflow overflowPolicy = UART_OVERFLOW_DEFAULT;
+
+/* Given whenever the handler frees TX space, for writers that block */
+static SemaphoreHandle_t txSpace;
+
+static void startTx(void)
+{
+	const uint8_t *data;
+
+	txChunk = txRing.readRegion(&data);
+	txBusy = txChunk != 0;
+	if (txBusy)
+		XUartPs_Send(&uart, const_cast<uint8_t *>(data), txChunk);
+}
+
+/* total is how much of the current receive request has been filled */
+static void creditRx(uint32_t total)
+{
+	uint32_t fresh = total - rxCredited;
+
+	rxCredited = total;
+	if (rxDropping)
+		rxDropped += fresh;
+	else
+		rxRing.commitWrite(fresh);
+}
+
+static void startRx(void)
+{
+	uint8_t *region;
+	size_t len = rxRing.writeRegion(&region);
+
+	rxDropping = len == 0;
+	if (rxDropping) {
+		region = rxScratch;
+		len = sizeof(rxScratch);
+	}
+
+	rxCredited = 0;
+	creditRx(XUartPs_Recv(&uart, region, len));
+}
+
+static void uartHandler(void *ref, u32 event, u32 eventData)
+{
+	BaseType_t woken = pdFALSE;
+
+	(void)ref;
+
+	switch (event) {
+	case XUARTPS_EVENT_SENT_DATA:
+		txRing.commitRead(txChunk);
+		startTx();
+		xSemaphoreGiveFromISR(txSpace, &woken);
+		break;
+	case XUARTPS_EVENT_RECV_DATA:
+		/* The request is full, move on to the next free region */
+		creditRx(eventData);
+		startRx();
+		break;
+	case XUARTPS_EVENT_RECV_TOUT:
+	case XUARTPS_EVENT_RECV_ERROR:
+		/* A partial request. Keep it open unless it's only the scratch
+		 * buffer and the ring may have room again. */
+		creditRx(eventData);
+		if (rxDropping)
+			startRx();
+		break;
+	default:
+		break;
+	}
+
+	portYIELD_FROM_ISR(woken);
+}
+
+/* Blocking is only allowed from a task, outside critical sections. That
+ * includes IsrLock and taskENTER_CRITICAL_FROM_ISR() sections, which raise
+ * the GIC priority mask without counting in ulCriticalNesting: the UART
+ * interrupt can't drain the ring under them, and a task switch would end
+ * them early. */
+static bool canBlock(void)
+{
+	return ulPortInterruptNesting == 0 && ulCriticalNesting == 0 &&
+			portICCPMR_PRIORITY_MASK_REGISTER == UART_PRIORITY_UNMASKED &&
+			(mfcpsr() & XREG_CPSR_IRQ_ENABLE) == 0 &&
+			xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+void uartInit(void)
+{
+	XUartPs_Config *config = XUartPs_LookupConfig(XPAR_XUARTPS_0_DEVICE_ID);
+
+	/* CfgInitialize resets the FIFOs, let the boot messages out first */
+	while (!XUartPs_IsTransmitFifoEmpty(config->BaseAddress))
+		;
+
+	XUartPs_CfgInitialize(&uart, config, config->BaseAddress);
+	XUartPs_SetHandler(&uart, uartHandler, nullptr);
+	XUartPs_SetFifoThreshold(&uart, 32);
+	XUartPs_SetRecvTimeout(&uart, 8);
+	XUartPs_SetInterruptMask(&uart, XUARTPS_IXR_RXOVR | XUARTPS_IXR_RXFULL | XUARTPS_IXR_TOUT |
+			XUARTPS_IXR_OVER | XUARTPS_IXR_FRAMING | XUARTPS_IXR_PARITY);
+
+	txSpace = xSemaphoreCreateBinary();
+	configASSERT(txSpace);
+
+	xPortInstallInterruptHandler(XPAR_XUARTPS_0_INTR, (XInterruptHandler)XUartPs_InterruptHandler, &uart);
+
+	{
+		IsrLock lock;
+
+		startRx();
+		ready = true;
+	}
+
+	vPortEnableInterrupt(XPAR_XUARTPS_0_INTR);
+}
+
+void uartSetOverflowPolicy(UartOverflow policy)
+{
+	overflowPolicy = policy;
+}
+
+size_t uartWrite(const void *data, size_t len)
+{
+	const uint8_t *src = static_cast<const uint8_t *>(data);
+	size_t done = 0;
+
+	for (;;) {
+		{
+			IsrLock lock;
+
+			done += txRing.write(src + done, len - done);
+			if (!txBusy)
+				startTx();
+		}
+
+		if (done == len)
+			break;
+
+		if (overflowPolicy != UART_OVERFLOW_BLOCK || !canBlock()) {
+			IsrLock lock;
+
+			txDropped += len - done;
+			break;
+		}
+
+		xSemaphoreTake(txSpace, portMAX_DELAY);
+	}
+
+	return done;
+}
+
+size_t uartRead(void *data, size_t len)
+{
+	size_t n = rxRing.read(data, len);
+
+	if (n != 0 && rxDropping) {
+		IsrLock lock;
+
+		/* Close the scratch request and go back to the ring */
+		if (rxDropping) {
+			creditRx(uart.ReceiveBuffer.RequestedBytes - uart.ReceiveBuffer.RemainingBytes);
+			startRx();
+		}
+	}
+
+	return n;
+}
+
+bool uartFlush(TickType_t timeout)
+{
+	TimeOut_t start;
+
+	vTaskSetTimeOutState(&start);
+	while (txRing.used() != 0 || !XUartPs_IsTransmitEmpty(&uart)) {
+		if (xTaskCheckForTimeOut(&start, &timeout) != pdFALSE)
+			return false;
+		vTaskDelay(1);
+	}
+
+	return true;
+}
+
+uint32_t uartTxDropped(void)
+{
+	return txDropped;
+}
+
+uint32_t uartRxDropped(void)
+{
+	return rxDropped;
+}
+
+void outbyte(char c)
+{
+	/* Exception handlers run with IRQs masked and would never see the ring
+	 * drain */
+	if (!ready || (mfcpsr() & XREG_CPSR_IRQ_ENABLE)) {
+		XUartPs_SendByte(STDOUT_BASEADDRESS, c);
+		return;
+	}
+
+	uartWrite(&c, 1);
+}
+
+char inbyte(void)
+{
+	char c;
+
+	if (!ready || !canBlock())
+		return XUartPs_RecvByte(STDIN_BASEADDRESS);
+
+	while (uartRead(&c, 1) == 0)
+		vTaskDelay(1);
+
+	return c;
+}
@@ -0,0 +1,59 @@
+#ifndef UART_H
+#define UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/*
+ * Interrupt-driven console UART. Once uartInit() has run, outbyte() (and so
+ * xil_printf) and inbyte() go through a TX and an RX ring instead of
+ * spinning on the UART FIFOs. The xuartps interrupt handler moves bytes
+ * between the rings and the FIFOs. A task printing a line just copies it into
+ * the TX ring.
+ *
+ * Before uartInit(), and from exception handlers that run with IRQs off,
+ * output falls back to polling the FIFO directly. That output is not
+ * ordered with anything still waiting in the TX ring.
+ */
+
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE	4096
+#endif
+
+#ifndef UART_RX_RING_SIZE
+#define UART_RX_RING_SIZE	256
+#endif
+
+/* What uartWrite() does when the TX ring is full */
+enum UartOverflow {
+	UART_OVERFLOW_DROP,		/* drop what doesn't fit and count it */
+	UART_OVERFLOW_BLOCK,	/* wait for room; drops anyway from an ISR, a critical section or before the scheduler runs */
+};
+
+#ifndef UART_OVERFLOW_DEFAULT
+#define UART_OVERFLOW_DEFAULT	UART_OVERFLOW_BLOCK
+#endif
+
+/* Installs the interrupt handler. Call from a task once the scheduler runs. */
+void uartInit(void);
+
+void uartSetOverflowPolicy(UartOverflow policy);
+
+/* Queues len bytes for sending, returns how many were queued */
+size_t uartWrite(const void *data, size_t len);
+
+/* Copies out up to len received bytes without waiting. Only one task may
+ * read. */
+size_t uartRead(void *data, size_t len);
+
+/* Waits for everything queued so far to leave the UART. Returns false if
+ * that took longer than timeout. */
+bool uartFlush(TickType_t timeout);
+
+/* Bytes thrown away because a ring was full */
+uint32_t uartTxDropped(void);
+uint32_t uartRxDropped(void);
+
+#endif /* UART_H */
@@ -0,0 +1,659 @@
+/*
+ * Two-Level Segregated Fit implementation of pvPortMalloc() and vPortFree().
+ *
+ * A drop-in replacement for heap_4.c: same heap array (configTOTAL_HEAP_SIZE,
+ * configAPPLICATION_ALLOCATED_HEAP), same scheduler-suspension locking, same
+ * trace and malloc-failed hooks. Where heap_4 walks its address-ordered free
+ * list on every allocation, this finds a block with two bitmap lookups and
+ * coalesces on free through physical neighbour links, so both operations run
+ * in constant time regardless of how fragmented the heap is.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+ * all the API functions to use the MPU wrappers. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "xil_printf.h"
+#include "heap_tlsf.h"
+
+#if ( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+	#error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+#if ( ( 1 << tlsfALIGN_SIZE_LOG2 ) != portBYTE_ALIGNMENT )
+	#error tlsfALIGN_SIZE_LOG2 does not match portBYTE_ALIGNMENT
+#endif
+
+#if ( tlsfFL_INDEX_COUNT > 32 ) || ( tlsfSL_INDEX_COUNT > 32 )
+	#error TLSF bitmaps are 32 bits wide
+#endif
+
+#ifndef configHEAP_CLEAR_MEMORY_ON_FREE
+	#define configHEAP_CLEAR_MEMORY_ON_FREE    0
+#endif
+
+/* Max value that fits in a size_t type. */
+#define heapSIZE_MAX						( ~( ( size_t ) 0 ) )
+
+/* Check if multiplying a and b will result in overflow. */
+#define heapMULTIPLY_WILL_OVERFLOW( a, b )	( ( ( a ) > 0 ) && ( ( b ) > ( heapSIZE_MAX / ( a ) ) ) )
+
+/* Payload sizes are multiples of portBYTE_ALIGNMENT, so bit 0 is free to
+ * mark blocks that currently sit in a free list. */
+#define tlsfBLOCK_FREE_BIT		( ( size_t ) 1 )
+#define tlsfBLOCK_SIZE( pxBlock )		( ( pxBlock )->xSize & ~tlsfBLOCK_FREE_BIT )
+#define tlsfBLOCK_IS_FREE( pxBlock )	( ( ( pxBlock )->xSize & tlsfBLOCK_FREE_BIT ) != 0 )
+
+/*-----------------------------------------------------------*/
+
+/* Allocate the memory for the heap. */
+#if ( configAPPLICATION_ALLOCATED_HEAP == 1 )
+	extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#else
+	PRIVILEGED_DATA static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+/*
+ * Every block, used or free, starts with a link to the block physically in
+ * front of it and its payload size. The free list links are only valid while
+ * the block is free and overlay the first bytes of the payload.
+ */
+typedef struct A_TLSF_BLOCK
+{
+	struct A_TLSF_BLOCK * pxPrevPhysBlock;
+	size_t xSize;
+	struct A_TLSF_BLOCK * pxNextFree;
+	struct A_TLSF_BLOCK * pxPrevFree;
+} TlsfBlock_t;
+
+#define tlsfBLOCK_OVERHEAD		( ( size_t ) offsetof( TlsfBlock_t, pxNextFree ) )
+#define tlsfBLOCK_SIZE_MIN		( sizeof( TlsfBlock_t ) - tlsfBLOCK_OVERHEAD )
+#define tlsfBLOCK_SIZE_MAX		( ( size_t ) 1 << tlsfFL_INDEX_MAX )
+
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void ) PRIVILEGED_FUNCTION;
+static void prvInsertFreeBlock( TlsfBlock_t * pxBlock ) PRIVILEGED_FUNCTION;
+static void prvRemoveFreeBlock( TlsfBlock_t * pxBlock ) PRIVILEGED_FUNCTION;
+
+/*-----------------------------------------------------------*/
+
+/* First level bitmap: bit n set when any list in row n is non-empty. */
+PRIVILEGED_DATA static uint32_t ulFlBitmap = 0U;
+PRIVILEGED_DATA static uint32_t ulSlBitmap[ tlsfFL_INDEX_COUNT ];
+PRIVILEGED_DATA static TlsfBlock_t * pxFreeLists[ tlsfFL_INDEX_COUNT ][ tlsfSL_INDEX_COUNT ];
+
+/* Zero sized, permanently used block at the top of the heap so that the
+ * last real block always has a physical neighbour to look at. */
+PRIVILEGED_DATA static TlsfBlock_t * pxEnd = NULL;
+
+PRIVILEGED_DATA static size_t xTotalHeapSize = 0U;
+PRIVILEGED_DATA static size_t xFreeBytesRemaining = 0U;
+PRIVILEGED_DATA static size_t xMinimumEverFreeBytesRemaining = 0U;
+PRIVILEGED_DATA static size_t xNumberOfSuccessfulAllocations = 0;
+PRIVILEGED_DATA static size_t xNumberOfSuccessfulFrees = 0;
+PRIVILEGED_DATA static size_t xNumberOfFailedAllocations = 0;
+PRIVILEGED_DATA static TlsfClassStats_t xClassStats[ tlsfFL_INDEX_COUNT ];
+
+/*-----------------------------------------------------------*/
+
+/* Index of the most significant set bit. CLZ on the A9. */
+static inline UBaseType_t prvFls( size_t xValue )
+{
+	return ( UBaseType_t ) ( ( sizeof( unsigned long ) * 8 ) - 1 -
+		__builtin_clzl( ( unsigned long ) xValue ) );
+}
+
+/* Index of the least significant set bit. */
+static inline UBaseType_t prvFfs( uint32_t ulValue )
+{
+	return ( UBaseType_t ) __builtin_ctz( ulValue );
+}
+
+/* The list a block of exactly xSize bytes belongs in. */
+static inline void prvMappingInsert( size_t xSize, UBaseType_t * puxFl, UBaseType_t * puxSl )
+{
+	UBaseType_t uxFl, uxSl;
+
+	if( xSize < tlsfSMALL_BLOCK_SIZE )
+	{
+		uxFl = 0;
+		uxSl = ( UBaseType_t ) ( xSize / ( tlsfSMALL_BLOCK_SIZE / tlsfSL_INDEX_COUNT ) );
+	}
+	else
+	{
+		uxFl = prvFls( xSize );
+		uxSl = ( UBaseType_t ) ( xSize >> ( uxFl - tlsfSL_INDEX_COUNT_LOG2 ) ) ^ tlsfSL_INDEX_COUNT;
+		uxFl -= ( tlsfFL_INDEX_SHIFT - 1 );
+	}
+
+	*puxFl = uxFl;
+	*puxSl = uxSl;
+}
+
+/* The first list whose every block is at least xSize bytes. Rounds the
+ * request up to the next list boundary so no list walk is ever needed. */
+static inline void prvMappingSearch( size_t xSize, UBaseType_t * puxFl, UBaseType_t * puxSl )
+{
+	if( xSize >= tlsfSMALL_BLOCK_SIZE )
+	{
+		xSize += ( ( size_t ) 1 << ( prvFls( xSize ) - tlsfSL_INDEX_COUNT_LOG2 ) ) - 1;
+	}
+
+	prvMappingInsert( xSize, puxFl, puxSl );
+}
+
+static inline TlsfBlock_t * prvNextPhysBlock( const TlsfBlock_t * pxBlock )
+{
+	return ( TlsfBlock_t * ) ( ( uint8_t * ) pxBlock + tlsfBLOCK_OVERHEAD + tlsfBLOCK_SIZE( pxBlock ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static TlsfBlock_t * prvFindFreeBlock( UBaseType_t uxFl, UBaseType_t uxSl )
+{
+	uint32_t ulMap;
+
+	if( uxFl >= tlsfFL_INDEX_COUNT )
+	{
+		return NULL;
+	}
+
+	/* Any list in this row at or above the second level index will do */
+	ulMap = ulSlBitmap[ uxFl ] & ( ~0UL << uxSl );
+
+	if( ulMap == 0 )
+	{
+		/* Nothing in this row, take the smallest non-empty row above it */
+		ulMap = ( uxFl + 1 < 32 ) ? ( ulFlBitmap & ( ~0UL << ( uxFl + 1 ) ) ) : 0;
+
+		if( ulMap == 0 )
+		{
+			return NULL;
+		}
+
+		uxFl = prvFfs( ulMap );
+		ulMap = ulSlBitmap[ uxFl ];
+	}
+
+	uxSl = prvFfs( ulMap );
+
+	return pxFreeLists[ uxFl ][ uxSl ];
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( TlsfBlock_t * pxBlock )
+{
+	UBaseType_t uxFl, uxSl;
+	size_t xSize = tlsfBLOCK_SIZE( pxBlock );
+
+	prvMappingInsert( xSize, &uxFl, &uxSl );
+
+	pxBlock->xSize = xSize | tlsfBLOCK_FREE_BIT;
+	pxBlock->pxPrevFree = NULL;
+	pxBlock->pxNextFree = pxFreeLists[ uxFl ][ uxSl ];
+
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock;
+	}
+
+	pxFreeLists[ uxFl ][ uxSl ] = pxBlock;
+	ulFlBitmap |= ( 1UL << uxFl );
+	ulSlBitmap[ uxFl ] |= ( 1UL << uxSl );
+
+	xClassStats[ uxFl ].xFreeBlocks++;
+	xClassStats[ uxFl ].xFreeBytes += xSize;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( TlsfBlock_t * pxBlock )
+{
+	UBaseType_t uxFl, uxSl;
+	size_t xSize = tlsfBLOCK_SIZE( pxBlock );
+
+	prvMappingInsert( xSize, &uxFl, &uxSl );
+
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock->pxPrevFree;
+	}
+
+	if( pxBlock->pxPrevFree != NULL )
+	{
+		pxBlock->pxPrevFree->pxNextFree = pxBlock->pxNextFree;
+	}
+	else
+	{
+		pxFreeLists[ uxFl ][ uxSl ] = pxBlock->pxNextFree;
+
+		if( pxFreeLists[ uxFl ][ uxSl ] == NULL )
+		{
+			ulSlBitmap[ uxFl ] &= ~( 1UL << uxSl );
+
+			if( ulSlBitmap[ uxFl ] == 0 )
+			{
+				ulFlBitmap &= ~( 1UL << uxFl );
+			}
+		}
+	}
+
+	pxBlock->xSize = xSize;
+	pxBlock->pxNextFree = NULL;
+	pxBlock->pxPrevFree = NULL;
+
+	xClassStats[ uxFl ].xFreeBlocks--;
+	xClassStats[ uxFl ].xFreeBytes -= xSize;
+}
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+	TlsfBlock_t * pxBlock = NULL;
+	TlsfBlock_t * pxRemainder;
+	UBaseType_t uxFl, uxSl;
+	void * pvReturn = NULL;
+	size_t xRequestedSize = xWantedSize;
+
+	( void ) xRequestedSize;
+
+	if( ( xWantedSize > 0 ) && ( xWantedSize < tlsfBLOCK_SIZE_MAX ) )
+	{
+		xWantedSize = ( xWantedSize + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+		if( xWantedSize < tlsfBLOCK_SIZE_MIN )
+		{
+			xWantedSize = tlsfBLOCK_SIZE_MIN;
+		}
+	}
+	else
+	{
+		xWantedSize = 0;
+	}
+
+	vTaskSuspendAll();
+	{
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+
+		if( xWantedSize != 0 )
+		{
+			prvMappingSearch( xWantedSize, &uxFl, &uxSl );
+			pxBlock = prvFindFreeBlock( uxFl, uxSl );
+		}
+
+		if( pxBlock != NULL )
+		{
+			prvRemoveFreeBlock( pxBlock );
+
+			/* Hand back anything big enough to be a block of its own */
+			if( tlsfBLOCK_SIZE( pxBlock ) - xWantedSize >= sizeof( TlsfBlock_t ) )
+			{
+				pxRemainder = ( TlsfBlock_t * ) ( ( uint8_t * ) pxBlock + tlsfBLOCK_OVERHEAD + xWantedSize );
+				pxRemainder->xSize = tlsfBLOCK_SIZE( pxBlock ) - xWantedSize - tlsfBLOCK_OVERHEAD;
+				pxRemainder->pxPrevPhysBlock = pxBlock;
+				prvNextPhysBlock( pxRemainder )->pxPrevPhysBlock = pxRemainder;
+				pxBlock->xSize = xWantedSize;
+
+				prvInsertFreeBlock( pxRemainder );
+			}
+
+			xFreeBytesRemaining -= tlsfBLOCK_SIZE( pxBlock ) + tlsfBLOCK_OVERHEAD;
+
+			if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+			{
+				xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+			}
+
+			prvMappingInsert( tlsfBLOCK_SIZE( pxBlock ), &uxFl, &uxSl );
+			xClassStats[ uxFl ].xAllocations++;
+			xClassStats[ uxFl ].xBlocksInUse++;
+			xClassStats[ uxFl ].xBytesInUse += tlsfBLOCK_SIZE( pxBlock );
+			xNumberOfSuccessfulAllocations++;
+
+			pvReturn = ( uint8_t * ) pxBlock + tlsfBLOCK_OVERHEAD;
+		}
+		else
+		{
+			xNumberOfFailedAllocations++;
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if ( tlsfRECORD_TRACE == 1 )
+	{
+		/* The block is the caller's until it frees it, so the line can go out
+		 * with the scheduler running */
+		xil_printf( "M %08x %u\r\n", ( unsigned ) ( uintptr_t ) pvReturn, ( unsigned ) xRequestedSize );
+	}
+	#endif
+
+	#if ( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	configASSERT( ( ( ( size_t ) pvReturn ) & ( size_t ) portBYTE_ALIGNMENT_MASK ) == 0 );
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+	TlsfBlock_t * pxBlock;
+	TlsfBlock_t * pxNeighbour;
+	UBaseType_t uxFl, uxSl;
+
+	if( pv == NULL )
+	{
+		return;
+	}
+
+	pxBlock = ( TlsfBlock_t * ) ( ( uint8_t * ) pv - tlsfBLOCK_OVERHEAD );
+
+	configASSERT( !tlsfBLOCK_IS_FREE( pxBlock ) );
+
+	if( tlsfBLOCK_IS_FREE( pxBlock ) )
+	{
+		return;
+	}
+
+	#if ( configHEAP_CLEAR_MEMORY_ON_FREE == 1 )
+	{
+		( void ) memset( pv, 0, tlsfBLOCK_SIZE( pxBlock ) );
+	}
+	#endif
+
+	#if ( tlsfRECORD_TRACE == 1 )
+	{
+		/* Before the block goes back, so no allocation of the same address
+		 * can be logged ahead of this free */
+		xil_printf( "F %08x\r\n", ( unsigned ) ( uintptr_t ) pv );
+	}
+	#endif
+
+	vTaskSuspendAll();
+	{
+		prvMappingInsert( tlsfBLOCK_SIZE( pxBlock ), &uxFl, &uxSl );
+		xClassStats[ uxFl ].xFrees++;
+		xClassStats[ uxFl ].xBlocksInUse--;
+		xClassStats[ uxFl ].xBytesInUse -= tlsfBLOCK_SIZE( pxBlock );
+
+		xFreeBytesRemaining += tlsfBLOCK_SIZE( pxBlock ) + tlsfBLOCK_OVERHEAD;
+		traceFREE( pv, tlsfBLOCK_SIZE( pxBlock ) );
+
+		/* Merge with the block in front, if free */
+		pxNeighbour = pxBlock->pxPrevPhysBlock;
+
+		if( ( pxNeighbour != NULL ) && tlsfBLOCK_IS_FREE( pxNeighbour ) )
+		{
+			prvRemoveFreeBlock( pxNeighbour );
+			pxNeighbour->xSize += tlsfBLOCK_OVERHEAD + tlsfBLOCK_SIZE( pxBlock );
+			pxBlock = pxNeighbour;
+			prvNextPhysBlock( pxBlock )->pxPrevPhysBlock = pxBlock;
+		}
+
+		/* And with the block behind. pxEnd is never free, so this stops there */
+		pxNeighbour = prvNextPhysBlock( pxBlock );
+
+		if( tlsfBLOCK_IS_FREE( pxNeighbour ) )
+		{
+			prvRemoveFreeBlock( pxNeighbour );
+			pxBlock->xSize += tlsfBLOCK_OVERHEAD + tlsfBLOCK_SIZE( pxNeighbour );
+			prvNextPhysBlock( pxBlock )->pxPrevPhysBlock = pxBlock;
+		}
+
+		prvInsertFreeBlock( pxBlock );
+		xNumberOfSuccessfulFrees++;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+void * pvPortCalloc( size_t xNum, size_t xSize )
+{
+	void * pv = NULL;
+
+	if( heapMULTIPLY_WILL_OVERFLOW( xNum, xSize ) == 0 )
+	{
+		pv = pvPortMalloc( xNum * xSize );
+
+		if( pv != NULL )
+		{
+			( void ) memset( pv, 0, xNum * xSize );
+		}
+	}
+
+	return pv;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void ) /* PRIVILEGED_FUNCTION */
+{
+	TlsfBlock_t * pxFirstBlock;
+	size_t xAddress = ( size_t ) ucHeap;
+	size_t xHeapSize = configTOTAL_HEAP_SIZE;
+
+	/* Ensure the heap starts on a correctly aligned boundary. */
+	if( ( xAddress & portBYTE_ALIGNMENT_MASK ) != 0 )
+	{
+		xAddress += ( portBYTE_ALIGNMENT - 1 );
+		xAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		xHeapSize -= xAddress - ( size_t ) ucHeap;
+	}
+
+	xHeapSize &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+	/* One free block spanning everything but its own header and pxEnd */
+	pxFirstBlock = ( TlsfBlock_t * ) xAddress;
+	pxFirstBlock->pxPrevPhysBlock = NULL;
+	pxFirstBlock->xSize = xHeapSize - tlsfBLOCK_OVERHEAD - sizeof( TlsfBlock_t );
+
+	if( pxFirstBlock->xSize >= tlsfBLOCK_SIZE_MAX )
+	{
+		pxFirstBlock->xSize = tlsfBLOCK_SIZE_MAX - portBYTE_ALIGNMENT;
+	}
+
+	pxEnd = prvNextPhysBlock( pxFirstBlock );
+	pxEnd->pxPrevPhysBlock = pxFirstBlock;
+	pxEnd->xSize = 0;
+
+	xTotalHeapSize = tlsfBLOCK_SIZE( pxFirstBlock ) + tlsfBLOCK_OVERHEAD;
+	xFreeBytesRemaining = xTotalHeapSize;
+	xMinimumEverFreeBytesRemaining = xTotalHeapSize;
+
+	prvInsertFreeBlock( pxFirstBlock );
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t * pxHeapStats )
+{
+	TlsfBlock_t * pxBlock;
+	size_t xBlocks = 0, xMaxSize = 0, xMinSize = portMAX_DELAY; /* portMAX_DELAY used as a portable way of getting the maximum value. */
+	UBaseType_t uxFl, uxSl;
+
+	vTaskSuspendAll();
+	{
+		for( uxFl = 0; uxFl < tlsfFL_INDEX_COUNT; uxFl++ )
+		{
+			for( uxSl = 0; uxSl < tlsfSL_INDEX_COUNT; uxSl++ )
+			{
+				for( pxBlock = pxFreeLists[ uxFl ][ uxSl ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+				{
+					xBlocks++;
+
+					if( tlsfBLOCK_SIZE( pxBlock ) > xMaxSize )
+					{
+						xMaxSize = tlsfBLOCK_SIZE( pxBlock );
+					}
+
+					if( tlsfBLOCK_SIZE( pxBlock ) < xMinSize )
+					{
+						xMinSize = tlsfBLOCK_SIZE( pxBlock );
+					}
+				}
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	pxHeapStats->xSizeOfLargestFreeBlockInBytes = xMaxSize;
+	pxHeapStats->xSizeOfSmallestFreeBlockInBytes = xMinSize;
+	pxHeapStats->xNumberOfFreeBlocks = xBlocks;
+
+	taskENTER_CRITICAL();
+	{
+		pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+		pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+		pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+		pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetTlsfHeapStats( TlsfHeapStats_t * pxStats )
+{
+	TlsfBlock_t * pxBlock;
+	UBaseType_t uxFl, uxSl;
+	size_t xLargest = 0;
+
+	vTaskSuspendAll();
+	{
+		/* The largest free block can only be in the highest non-empty list,
+		 * so this is the one list that needs walking */
+		if( ulFlBitmap != 0 )
+		{
+			uxFl = prvFls( ulFlBitmap );
+			uxSl = prvFls( ulSlBitmap[ uxFl ] );
+
+			for( pxBlock = pxFreeLists[ uxFl ][ uxSl ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+			{
+				if( tlsfBLOCK_SIZE( pxBlock ) > xLargest )
+				{
+					xLargest = tlsfBLOCK_SIZE( pxBlock );
+				}
+			}
+		}
+
+		pxStats->xTotalHeapSize = xTotalHeapSize;
+		pxStats->xFreeBytes = xFreeBytesRemaining;
+		pxStats->xMinimumEverFreeBytes = xMinimumEverFreeBytesRemaining;
+		pxStats->xLargestFreeBlock = xLargest;
+		pxStats->xFailedAllocations = xNumberOfFailedAllocations;
+		pxStats->xFreeBlocks = 0;
+
+		for( uxFl = 0; uxFl < tlsfFL_INDEX_COUNT; uxFl++ )
+		{
+			pxStats->xFreeBlocks += xClassStats[ uxFl ].xFreeBlocks;
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	if( pxStats->xFreeBytes != 0 )
+	{
+		pxStats->uxFragmentationPercent = ( UBaseType_t )
+			( 100 - ( ( ( uint64_t ) ( xLargest + tlsfBLOCK_OVERHEAD ) * 100 ) / pxStats->xFreeBytes ) );
+	}
+	else
+	{
+		pxStats->uxFragmentationPercent = 0;
+	}
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortGetTlsfClassStats( UBaseType_t uxClass, TlsfClassStats_t * pxStats )
+{
+	if( uxClass >= tlsfFL_INDEX_COUNT )
+	{
+		return pdFAIL;
+	}
+
+	vTaskSuspendAll();
+	{
+		*pxStats = xClassStats[ uxClass ];
+	}
+	( void ) xTaskResumeAll();
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetTlsfClassLowerBound( UBaseType_t uxClass )
+{
+	if( uxClass == 0 )
+	{
+		return 0;
+	}
+
+	return ( size_t ) 1 << ( uxClass + tlsfFL_INDEX_SHIFT - 1 );
+}
+/*-----------------------------------------------------------*/
+
+void vPortPrintTlsfStats( void )
+{
+	TlsfHeapStats_t xHeap;
+	TlsfClassStats_t xClass;
+	UBaseType_t uxClass;
+
+	vPortGetTlsfHeapStats( &xHeap );
+
+	xil_printf( "TLSF heap: %u/%u bytes free (min ever %u), largest block %u, "
+		"%u free blocks, %u%% fragmented, %u failed allocations\r\n",
+		( unsigned ) xHeap.xFreeBytes, ( unsigned ) xHeap.xTotalHeapSize,
+		( unsigned ) xHeap.xMinimumEverFreeBytes, ( unsigned ) xHeap.xLargestFreeBlock,
+		( unsigned ) xHeap.xFreeBlocks, ( unsigned ) xHeap.uxFragmentationPercent,
+		( unsigned ) xHeap.xFailedAllocations );
+
+	xil_printf( "  class     >=    allocs     frees  in use  bytes used  free blks  bytes free\r\n" );
+
+	for( uxClass = 0; uxClass < tlsfFL_INDEX_COUNT; uxClass++ )
+	{
+		( void ) xPortGetTlsfClassStats( uxClass, &xClass );
+
+		if( ( xClass.xAllocations == 0 ) && ( xClass.xFreeBlocks == 0 ) )
+		{
+			continue;
+		}
+
+		xil_printf( "  %5u %9u %9u %9u %7u %11u %10u %11u\r\n", ( unsigned ) uxClass,
+			( unsigned ) xPortGetTlsfClassLowerBound( uxClass ), ( unsigned ) xClass.xAllocations,
+			( unsigned ) xClass.xFrees, ( unsigned ) xClass.xBlocksInUse,
+			( unsigned ) xClass.xBytesInUse, ( unsigned ) xClass.xFreeBlocks,
+			( unsigned ) xClass.xFreeBytes );
+	}
+}
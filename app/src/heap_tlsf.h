@@ -0,0 +1,77 @@
+#ifndef HEAP_TLSF_H
+#define HEAP_TLSF_H
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Two-Level Segregated Fit heap. heap_tlsf.c provides every symbol heap_4.c
+ * does, so linking it into the app keeps heap_4.o from being pulled out of
+ * libfreertos.a.
+ *
+ * Free blocks are binned by the position of their most significant bit (the
+ * first level) and then linearly into 2^tlsfSL_INDEX_COUNT_LOG2 slices (the
+ * second level). A bitmap per level means finding a fitting block is two
+ * count-leading/trailing-zero operations, whatever the fragmentation.
+ */
+
+/* Second-level subdivisions of each power of two, as a log2 */
+#ifndef tlsfSL_INDEX_COUNT_LOG2
+#define tlsfSL_INDEX_COUNT_LOG2		4
+#endif
+
+/* Largest block the heap can hold is just under 2^tlsfFL_INDEX_MAX bytes */
+#ifndef tlsfFL_INDEX_MAX
+#define tlsfFL_INDEX_MAX			30
+#endif
+
+/* Set to 1 to print every allocation and free on the console, in the format
+ * tools/heapbench replays ("M <addr> <size>" / "F <addr>") */
+#ifndef tlsfRECORD_TRACE
+#define tlsfRECORD_TRACE			0
+#endif
+
+#define tlsfALIGN_SIZE_LOG2			3
+#define tlsfSL_INDEX_COUNT			( 1 << tlsfSL_INDEX_COUNT_LOG2 )
+#define tlsfFL_INDEX_SHIFT			( tlsfSL_INDEX_COUNT_LOG2 + tlsfALIGN_SIZE_LOG2 )
+#define tlsfFL_INDEX_COUNT			( tlsfFL_INDEX_MAX - tlsfFL_INDEX_SHIFT + 1 )
+#define tlsfSMALL_BLOCK_SIZE		( ( size_t ) 1 << tlsfFL_INDEX_SHIFT )
+
+/* Statistics for one first-level size class. Class 0 holds every block
+ * smaller than tlsfSMALL_BLOCK_SIZE, class n >= 1 holds payloads from
+ * xPortGetTlsfClassLowerBound(n) up to twice that. */
+typedef struct xTLSF_CLASS_STATS
+{
+	size_t xAllocations;	/* Successful pvPortMalloc() calls served from this class */
+	size_t xFrees;			/* vPortFree() calls returning a block of this class */
+	size_t xBlocksInUse;
+	size_t xBytesInUse;
+	size_t xFreeBlocks;		/* Free blocks currently binned in this class */
+	size_t xFreeBytes;
+} TlsfClassStats_t;
+
+typedef struct xTLSF_HEAP_STATS
+{
+	size_t xTotalHeapSize;
+	size_t xFreeBytes;
+	size_t xMinimumEverFreeBytes;
+	size_t xLargestFreeBlock;
+	size_t xFreeBlocks;
+	size_t xFailedAllocations;
+	/* 0 when all free memory is one block, approaching 100 as it splinters */
+	UBaseType_t uxFragmentationPercent;
+} TlsfHeapStats_t;
+
+void vPortGetTlsfHeapStats( TlsfHeapStats_t * pxStats );
+BaseType_t xPortGetTlsfClassStats( UBaseType_t uxClass, TlsfClassStats_t * pxStats );
+size_t xPortGetTlsfClassLowerBound( UBaseType_t uxClass );
+void vPortPrintTlsfStats( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEAP_TLSF_H */
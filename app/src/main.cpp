@@ -2,6 +2,8 @@
 
 #include "xparameters.h"
 #include "xstatus.h"
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
 #include "netif/xadapter.h"
 #include "xil_printf.h"
 #include "lwip/dhcp.h"
@@ -9,13 +11,19 @@
 #include "lwip/init.h"
 
 #include "qspi.h"
+#include "Ocm.h"
+#include "Uart.h"
+#ifdef RUN_BENCHMARKS
+#include "Benchmarks.h"
+#endif
 
 #define PLATFORM_EMAC_BASEADDR XPAR_XEMACPS_0_BASEADDR
 #define THREAD_STACKSIZE 1024
 
-static QSpiFlash qspi;
+QSpiFlash qspi;
 
 void echo_application_thread(void *);
+void flash_update_thread(void *);
 
 static struct netif server_netif;
 struct netif *echo_netif;
@@ -96,23 +104,10 @@ static void network_thread(void *p)
     return;
 }
 
-/* This thread waits for either a DHCP-assigned IP address, or
-   falls back to a link-local IP address.
-   When one is obtained, it'll spawn the *actual* application
-   threads, and free itself. */
-static int main_thread(void)
+/* Waits for either a DHCP-assigned IP address, or falls back to a
+   link-local IP address. */
+static void wait_for_address(void)
 {
-    /* Initialie the QSPI driver */
-    qspi.init();
-
-    /* initialize lwIP before calling sys_thread_new */
-    lwip_init();
-
-    /* any thread using lwIP should be created using sys_thread_new */
-    sys_thread_new("NW_THRD", network_thread, NULL,
-        THREAD_STACKSIZE,
-            DEFAULT_THREAD_PRIO);
-
     while (1) {
         vTaskDelay(DHCP_FINE_TIMER_MSECS / portTICK_RATE_MS);
 
@@ -125,13 +120,59 @@ static int main_thread(void)
         if (server_netif.ip_addr.addr) {
             xil_printf("IP address received:\n\r");
             print_ip_settings(&(server_netif.ip_addr), &(server_netif.netmask), &(server_netif.gw));
-
-            sys_thread_new("echod", echo_application_thread, 0,
-                    THREAD_STACKSIZE,
-                    DEFAULT_THREAD_PRIO);
-            break;
+            return;
         }
     }
+}
+
+/* This thread brings up the network, waits for an address and
+   then spawns the *actual* application threads, and frees itself.
+   With RUN_BENCHMARKS it first runs the benchmarks one after
+   the other, with the network still down so that no frames or
+   network threads get in their way. Once the network is up it
+   repeats the latency benchmark under load, then runs the UDP
+   rate benchmark, which never returns. */
+static int main_thread(void)
+{
+    /* The scheduler has installed the port's vector table by now */
+    ocmInstallVectors();
+
+    /* Console output goes through the TX ring from here on */
+    uartInit();
+
+    /* Initialie the QSPI driver */
+    qspi.init();
+
+    /* initialize lwIP before calling sys_thread_new */
+    lwip_init();
+
+#ifdef RUN_BENCHMARKS
+    mboxBench();
+    ctxSwitchBench();
+    memBench();
+    cacheBench();
+    streamBench();
+    latencyBench(false);
+#endif
+
+    /* any thread using lwIP should be created using sys_thread_new */
+    sys_thread_new("NW_THRD", network_thread, NULL,
+        THREAD_STACKSIZE,
+            DEFAULT_THREAD_PRIO);
+
+    wait_for_address();
+
+    sys_thread_new("echod", echo_application_thread, 0,
+            THREAD_STACKSIZE,
+            DEFAULT_THREAD_PRIO);
+    sys_thread_new("updated", flash_update_thread, 0,
+            THREAD_STACKSIZE,
+            DEFAULT_THREAD_PRIO);
+
+#ifdef RUN_BENCHMARKS
+    latencyBench(true);
+    netRateBench();
+#endif
 
     vTaskDelete(NULL);
     return 0;
@@ -140,7 +181,17 @@ static int main_thread(void)
 /* Main entry point. Spawns the main thread */
 int main()
 {
-    xil_printf("Starting application\n\r");
+    /* boot.S started the cycle counter when the FSBL started, or when the
+       app did if it was loaded without one. The BootROM's time isn't in it,
+       and the FSBL runs at the BootROM's clock until ps7_init(), so this
+       undercounts a little. */
+    uint32_t bootCycles = mfcp(XREG_CP15_PERF_CYCLE_COUNTER);
+
+    /* Nothing in OCM may run before this */
+    ocmInit();
+
+    xil_printf("Starting application, %u us from FSBL start to main()\n\r",
+            bootCycles / (XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 1000000));
 
     sys_thread_new("main_thrd", (void(*)(void*))main_thread, 0,
                     THREAD_STACKSIZE,
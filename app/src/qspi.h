@@ -1,10 +1,18 @@
 #ifndef QSPI_H
 #define QSPI_H
 
+#include <string.h>
 #include <xqspips.h>
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #define QSPI_DEVICE_ID XPAR_XQSPIPS_0_DEVICE_ID
 
+#define QSPI_PAGE_SIZE		256
+#define QSPI_BLOCK_SIZE		65536
+#define QSPI_READ_CHUNK		256
+
 class QSpiFlash {
 private:
 	XQspiPs QspiInstance;
@@ -31,8 +39,9 @@ public:
 		XQspiPs_SetOptions(&QspiInstance, XQSPIPS_FORCE_SSELECT_OPTION |
 				XQSPIPS_HOLD_B_DRIVE_OPTION);
 
-		// Set the prescaler for QSPI clock
-		XQspiPs_SetClkPrescaler(&QspiInstance, XQSPIPS_CLK_PRESCALE_32);
+		// Set the prescaler for QSPI clock. 25 MHz, as the flasher uses on
+		// a single data line.
+		XQspiPs_SetClkPrescaler(&QspiInstance, XQSPIPS_CLK_PRESCALE_8);
 
 		// Assert the FLASH chip select.
 		XQspiPs_SetSlaveSelect(&QspiInstance);
@@ -67,6 +76,141 @@ public:
 
 		return status;
 	}
+
+	/*
+	 * Erase, program and read, for the network update service. They poll
+	 * the flash, sleeping through erases, so call them from a task. Only
+	 * one task may use them at a time.
+	 */
+
+	uint8_t eraseBlock(uint32_t address)
+	{
+		uint8_t cmd[4];
+
+		if (writeEnable() != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		cmd[0] = XQSPIPS_FLASH_OPCODE_SE;
+		setAddress(cmd, address);
+		if (XQspiPs_PolledTransfer(&QspiInstance, cmd, NULL, sizeof(cmd)) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		// A 64KB erase takes 150 ms or more, don't hog the CPU meanwhile
+		return waitReady(true);
+	}
+
+	uint8_t eraseSector(uint32_t address)
+	{
+		uint8_t cmd[4];
+
+		if (writeEnable() != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		cmd[0] = XQSPIPS_FLASH_OPCODE_BE_4K;
+		setAddress(cmd, address);
+		if (XQspiPs_PolledTransfer(&QspiInstance, cmd, NULL, sizeof(cmd)) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		return waitReady(true);
+	}
+
+	uint8_t program(uint32_t address, const uint8_t *data, uint32_t len)
+	{
+		uint8_t cmd[4 + QSPI_PAGE_SIZE];
+
+		while (len > 0) {
+			// A page program wraps around within its page, stop at the end
+			uint32_t size = QSPI_PAGE_SIZE - (address % QSPI_PAGE_SIZE);
+
+			if (size > len) {
+				size = len;
+			}
+
+			if (writeEnable() != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+
+			cmd[0] = XQSPIPS_FLASH_OPCODE_PP;
+			setAddress(cmd, address);
+			memcpy(&cmd[4], data, size);
+			if (XQspiPs_PolledTransfer(&QspiInstance, cmd, NULL, size + 4) != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+
+			if (waitReady(false) != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+
+			address += size;
+			data += size;
+			len -= size;
+		}
+
+		return XST_SUCCESS;
+	}
+
+	uint8_t read(uint32_t address, uint8_t *data, uint32_t len)
+	{
+		/* Fast read: command, address and a dummy byte come back first */
+		uint8_t cmd[5 + QSPI_READ_CHUNK] = {0};
+		uint8_t buf[5 + QSPI_READ_CHUNK];
+
+		while (len > 0) {
+			uint32_t size = (len > QSPI_READ_CHUNK) ? QSPI_READ_CHUNK : len;
+
+			cmd[0] = XQSPIPS_FLASH_OPCODE_FAST_READ;
+			setAddress(cmd, address);
+			if (XQspiPs_PolledTransfer(&QspiInstance, cmd, buf, size + 5) != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+			memcpy(data, &buf[5], size);
+
+			address += size;
+			data += size;
+			len -= size;
+		}
+
+		return XST_SUCCESS;
+	}
+
+private:
+	static void setAddress(uint8_t *cmd, uint32_t address)
+	{
+		cmd[1] = (uint8_t)(address >> 16);
+		cmd[2] = (uint8_t)(address >> 8);
+		cmd[3] = (uint8_t)address;
+	}
+
+	uint8_t writeEnable(void)
+	{
+		uint8_t cmd = XQSPIPS_FLASH_OPCODE_WREN;
+
+		return XQspiPs_PolledTransfer(&QspiInstance, &cmd, NULL, 1);
+	}
+
+	uint8_t waitReady(bool sleep)
+	{
+		uint8_t cmd[2] = { XQSPIPS_FLASH_OPCODE_RDSR1, 0 };
+		uint8_t status[2];
+
+		while (1) {
+			if (XQspiPs_PolledTransfer(&QspiInstance, cmd, status, sizeof(cmd)) != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+			if ((status[1] & 0x01) == 0) {	// WIP bit
+				return XST_SUCCESS;
+			}
+			if (sleep) {
+				vTaskDelay(1);
+			}
+		}
+	}
 };
 
+extern QSpiFlash qspi;
+
 #endif /* QSPI_H */
\ No newline at end of file
@@ -98,9 +98,16 @@
 
 #define configUSE_TASK_NOTIFICATIONS 1
 
+/* Index 0 is the application's, index 1 belongs to the lwIP sys_arch */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2
+
 #define configCHECK_FOR_STACK_OVERFLOW 2
 
-#define configUSE_TASK_FPU_SUPPORT 2
+/* 3 switches the FPU context lazily: registers are only saved and restored
+ * when a different task than the last one to use them executes an FPU
+ * instruction. Interrupt handlers may use the FPU, the IRQ entry saves the
+ * caller-saved registers around them (see portASM.S) */
+#define configUSE_TASK_FPU_SUPPORT 3
 
 #define configQUEUE_REGISTRY_SIZE 10
 
@@ -143,11 +150,14 @@
 #define configINTERRUPT_CONTROLLER_BASE_ADDRESS         ( XPAR_PS7_SCUGIC_0_DIST_BASEADDR )
 #define configINTERRUPT_CONTROLLER_CPU_INTERFACE_OFFSET ( -0xf00 )
 #define configUNIQUE_INTERRUPT_PRIORITIES                32
+/* portASM.S and port_asm_vectors.S include this file too */
+#ifndef __ASSEMBLER__
 void vApplicationAssert( const char *pcFile, uint32_t ulLine );
 void FreeRTOS_SetupTickInterrupt( void );
-#define configSETUP_TICK_INTERRUPT() FreeRTOS_SetupTickInterrupt()
-
 void FreeRTOS_ClearTickInterrupt( void );
+#endif
+
+#define configSETUP_TICK_INTERRUPT() FreeRTOS_SetupTickInterrupt()
 #define configCLEAR_TICK_INTERRUPT()	FreeRTOS_ClearTickInterrupt()
 
 #define portSET_INTERRUPT_MASK_FROM_ISR()	ulPortSetInterruptMask()
@@ -0,0 +1,296 @@
+/*
+ * Deferred interrupt handling for the Zynq-7000 FreeRTOS port. See
+ * deferred_work.h for how it's meant to be used.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "deferred_work.h"
+
+/* Xilinx includes. */
+#include "xscugic.h"
+
+#define deferredworkDIST_BASEADDR		XPAR_SCUGIC_0_DIST_BASEADDR
+
+typedef struct xDEFERRED_WORK_QUEUE
+{
+	DeferredWork_t * pxHead;
+	DeferredWork_t * pxTail;
+	TaskHandle_t xWorker;
+} DeferredWorkQueue_t;
+
+static DeferredWorkQueue_t xQueues[ deferredworkNUM_LEVELS ];
+static BaseType_t xInitialised = pdFALSE;
+
+static const char * const pcWorkerNames[ deferredworkNUM_LEVELS ] = { "dwork_hi", "dwork", "dwork_lo" };
+static const UBaseType_t uxWorkerPriorities[ deferredworkNUM_LEVELS ] =
+{
+	configDEFERRED_WORK_PRIORITY_HIGH,
+	configDEFERRED_WORK_PRIORITY_NORMAL,
+	configDEFERRED_WORK_PRIORITY_LOW
+};
+
+/*-----------------------------------------------------------*/
+
+/* Append to the queue and report whether the worker needs waking. Must be
+ * called with interrupts masked. */
+static BaseType_t prvEnqueue( DeferredWork_t * pxWork )
+{
+DeferredWorkQueue_t * pxQueue = &xQueues[ pxWork->uxLevel ];
+
+	pxWork->ulPosts++;
+
+	if( pxWork->uxPending != pdFALSE )
+	{
+		return pdFALSE;
+	}
+
+	pxWork->uxPending = pdTRUE;
+	pxWork->pxNext = NULL;
+
+	if( pxQueue->pxTail == NULL )
+	{
+		pxQueue->pxHead = pxWork;
+	}
+	else
+	{
+		pxQueue->pxTail->pxNext = pxWork;
+	}
+	pxQueue->pxTail = pxWork;
+
+	return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static DeferredWork_t * prvDequeue( DeferredWorkQueue_t * pxQueue )
+{
+DeferredWork_t * pxWork;
+
+	taskENTER_CRITICAL();
+	{
+		pxWork = pxQueue->pxHead;
+
+		if( pxWork != NULL )
+		{
+			pxQueue->pxHead = pxWork->pxNext;
+
+			if( pxQueue->pxHead == NULL )
+			{
+				pxQueue->pxTail = NULL;
+			}
+
+			/* Cleared before the function runs, so a post made while it's
+			 * running queues it again rather than being lost. */
+			pxWork->uxPending = pdFALSE;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return pxWork;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWorkerTask( void * pvParameters )
+{
+DeferredWorkQueue_t * pxQueue = ( DeferredWorkQueue_t * ) pvParameters;
+DeferredWork_t * pxWork;
+
+	for( ;; )
+	{
+		/* Drain before sleeping, items may have been posted before this
+		 * task existed to be notified. */
+		while( ( pxWork = prvDequeue( pxQueue ) ) != NULL )
+		{
+			pxWork->ulRuns++;
+			pxWork->pxFunction( pxWork->pvParameter );
+		}
+
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+	}
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xDeferredWorkInit( void )
+{
+BaseType_t xClaimed = pdFALSE;
+BaseType_t xReturn = pdPASS;
+UBaseType_t ux;
+TaskHandle_t xWorker;
+
+	taskENTER_CRITICAL();
+	{
+		if( xInitialised == pdFALSE )
+		{
+			xInitialised = pdTRUE;
+			xClaimed = pdTRUE;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xClaimed != pdFALSE )
+	{
+		for( ux = 0; ux < deferredworkNUM_LEVELS; ux++ )
+		{
+			if( xTaskCreate( prvWorkerTask, pcWorkerNames[ ux ], configDEFERRED_WORK_STACK_SIZE,
+							 &xQueues[ ux ], uxWorkerPriorities[ ux ], &xWorker ) != pdPASS )
+			{
+				xReturn = pdFAIL;
+				continue;
+			}
+
+			taskENTER_CRITICAL();
+			xQueues[ ux ].xWorker = xWorker;
+			taskEXIT_CRITICAL();
+		}
+	}
+
+	configASSERT( xReturn == pdPASS );
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vDeferredWorkCreate( DeferredWork_t * pxWork, DeferredWorkFunction_t pxFunction,
+						  void * pvParameter, UBaseType_t uxLevel )
+{
+	configASSERT( uxLevel < deferredworkNUM_LEVELS );
+
+	( void ) xDeferredWorkInit();
+
+	pxWork->pxFunction = pxFunction;
+	pxWork->pvParameter = pvParameter;
+	pxWork->pxNext = NULL;
+	pxWork->uxLevel = uxLevel;
+	pxWork->uxPending = pdFALSE;
+	pxWork->ulRuns = 0;
+	pxWork->ulPosts = 0;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xDeferredWorkPost( DeferredWork_t * pxWork )
+{
+BaseType_t xQueued;
+TaskHandle_t xWorker;
+
+	taskENTER_CRITICAL();
+	{
+		xQueued = prvEnqueue( pxWork );
+		xWorker = xQueues[ pxWork->uxLevel ].xWorker;
+	}
+	taskEXIT_CRITICAL();
+
+	if( ( xQueued != pdFALSE ) && ( xWorker != NULL ) )
+	{
+		xTaskNotifyGive( xWorker );
+	}
+
+	return xQueued;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xDeferredWorkPostFromISR( DeferredWork_t * pxWork, BaseType_t * pxHigherPriorityTaskWoken )
+{
+BaseType_t xQueued;
+TaskHandle_t xWorker;
+UBaseType_t uxSavedInterruptStatus;
+
+	/* Only needed if this interrupt can be nested by another that posts to
+	 * the same level, but it's a handful of instructions. */
+	uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	{
+		xQueued = prvEnqueue( pxWork );
+		xWorker = xQueues[ pxWork->uxLevel ].xWorker;
+	}
+	taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+	if( ( xQueued != pdFALSE ) && ( xWorker != NULL ) )
+	{
+		vTaskNotifyGiveFromISR( xWorker, pxHigherPriorityTaskWoken );
+	}
+
+	return xQueued;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetLine( uint16_t usInterruptID, uint32_t ulOffset )
+{
+	XScuGic_WriteReg( deferredworkDIST_BASEADDR,
+					  XSCUGIC_EN_DIS_OFFSET_CALC( ulOffset, usInterruptID ),
+					  1UL << ( usInterruptID % 32UL ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeferredIrqTopHalf( void * pvCallBackRef )
+{
+DeferredIrq_t * pxIrq = ( DeferredIrq_t * ) pvCallBackRef;
+BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	/* Mask the line so a level-sensitive source doesn't fire again before
+	 * the vendor handler has cleared it. */
+	prvSetLine( pxIrq->usInterruptID, XSCUGIC_DISABLE_OFFSET );
+	pxIrq->uxMasked = pdTRUE;
+
+	( void ) xDeferredWorkPostFromISR( &pxIrq->xWork, &xHigherPriorityTaskWoken );
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeferredIrqBottomHalf( void * pvParameter )
+{
+DeferredIrq_t * pxIrq = ( DeferredIrq_t * ) pvParameter;
+
+	pxIrq->pxHandler( pxIrq->pvCallBackRef );
+
+	/* Only undo our own mask. If the driver turned the line off meanwhile
+	 * it stays off, and if a newer top half has queued another run, that
+	 * run unmasks it once it has dealt with the hardware. */
+	taskENTER_CRITICAL();
+	{
+		if( ( pxIrq->uxMasked != pdFALSE ) && ( pxIrq->xWork.uxPending == pdFALSE ) )
+		{
+			pxIrq->uxMasked = pdFALSE;
+			prvSetLine( pxIrq->usInterruptID, XSCUGIC_ENABLE_SET_OFFSET );
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xDeferredWorkInstallInterrupt( DeferredIrq_t * pxIrq, uint16_t usInterruptID,
+										  XInterruptHandler pxHandler, void * pvCallBackRef,
+										  UBaseType_t uxLevel )
+{
+	pxIrq->pxHandler = pxHandler;
+	pxIrq->pvCallBackRef = pvCallBackRef;
+	pxIrq->usInterruptID = usInterruptID;
+	pxIrq->uxMasked = pdFALSE;
+	vDeferredWorkCreate( &pxIrq->xWork, prvDeferredIrqBottomHalf, pxIrq, uxLevel );
+
+	return xPortInstallInterruptHandler( usInterruptID, prvDeferredIrqTopHalf, pxIrq );
+}
+/*-----------------------------------------------------------*/
+
+void vDeferredWorkDisableInterrupt( DeferredIrq_t * pxIrq )
+{
+	taskENTER_CRITICAL();
+	{
+		pxIrq->uxMasked = pdFALSE;
+		prvSetLine( pxIrq->usInterruptID, XSCUGIC_DISABLE_OFFSET );
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vDeferredWorkEnableInterrupt( DeferredIrq_t * pxIrq )
+{
+	taskENTER_CRITICAL();
+	{
+		if( pxIrq->uxMasked == pdFALSE )
+		{
+			prvSetLine( pxIrq->usInterruptID, XSCUGIC_ENABLE_SET_OFFSET );
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,105 @@
+/*
+ * Deferred interrupt handling for the Zynq-7000 FreeRTOS port.
+ *
+ * An interrupt handler that has more to do than acknowledge its hardware
+ * posts a DeferredWork_t item instead, and the item's function runs later in
+ * one of a small set of worker tasks, one per deferredworkLEVEL_*. Workers
+ * are woken with direct-to-task notifications and run their items in the
+ * order they were posted. Posting an item that is already pending is a no-op,
+ * so a burst of interrupts collapses into a single run.
+ *
+ * For drivers whose vendor interrupt handler does all of the work (the
+ * XUartPs, XQspiPs and XAxiDma style of handler) xDeferredWorkInstallInterrupt()
+ * goes one step further: the real interrupt only masks the line at the GIC
+ * and posts the item, the vendor handler then runs in the worker task, and
+ * the line is unmasked once it returns. Driver callbacks therefore run in
+ * task context. A driver that wants such a line off must use
+ * vDeferredWorkDisableInterrupt(), or the worker turns it back on.
+ */
+
+#ifndef DEFERRED_WORK_H
+#define DEFERRED_WORK_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "xil_exception.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Worker priorities. The high level should sit above every task that talks
+ * to a deferred driver, so a bottom half can't be preempted by its own
+ * consumers. */
+#ifndef configDEFERRED_WORK_PRIORITY_HIGH
+#define configDEFERRED_WORK_PRIORITY_HIGH		( configMAX_PRIORITIES - 2 )
+#endif
+
+#ifndef configDEFERRED_WORK_PRIORITY_NORMAL
+#define configDEFERRED_WORK_PRIORITY_NORMAL		( configMAX_PRIORITIES - 3 )
+#endif
+
+#ifndef configDEFERRED_WORK_PRIORITY_LOW
+#define configDEFERRED_WORK_PRIORITY_LOW		( tskIDLE_PRIORITY + 1 )
+#endif
+
+#ifndef configDEFERRED_WORK_STACK_SIZE
+#define configDEFERRED_WORK_STACK_SIZE			( configMINIMAL_STACK_SIZE * 4 )
+#endif
+
+#define deferredworkLEVEL_HIGH					( 0 )
+#define deferredworkLEVEL_NORMAL				( 1 )
+#define deferredworkLEVEL_LOW					( 2 )
+#define deferredworkNUM_LEVELS					( 3 )
+
+typedef void ( * DeferredWorkFunction_t )( void * pvParameter );
+
+typedef struct xDEFERRED_WORK
+{
+	DeferredWorkFunction_t pxFunction;
+	void * pvParameter;
+	struct xDEFERRED_WORK * pxNext;
+	UBaseType_t uxLevel;
+	volatile UBaseType_t uxPending;
+	uint32_t ulRuns;			/* Times the function has been called */
+	uint32_t ulPosts;			/* Times the item was posted, coalesced or not */
+} DeferredWork_t;
+
+typedef struct xDEFERRED_IRQ
+{
+	DeferredWork_t xWork;
+	XInterruptHandler pxHandler;
+	void * pvCallBackRef;
+	uint16_t usInterruptID;
+	volatile UBaseType_t uxMasked;	/* The top half masked the line and the bottom half owes the unmask */
+} DeferredIrq_t;
+
+/* Creates the worker tasks. Safe to call more than once; every function
+ * below calls it, so drivers don't need to coordinate who goes first. */
+BaseType_t xDeferredWorkInit( void );
+
+void vDeferredWorkCreate( DeferredWork_t * pxWork, DeferredWorkFunction_t pxFunction,
+						  void * pvParameter, UBaseType_t uxLevel );
+
+/* Queue the item on its worker. Returns pdFALSE if it was already pending. */
+BaseType_t xDeferredWorkPost( DeferredWork_t * pxWork );
+BaseType_t xDeferredWorkPostFromISR( DeferredWork_t * pxWork, BaseType_t * pxHigherPriorityTaskWoken );
+
+/* Connect pxHandler to the interrupt so that it runs in a worker task, with
+ * the line masked at the GIC until it returns. The interrupt still has to be
+ * enabled by the caller, as with xPortInstallInterruptHandler(). */
+BaseType_t xDeferredWorkInstallInterrupt( DeferredIrq_t * pxIrq, uint16_t usInterruptID,
+										  XInterruptHandler pxHandler, void * pvCallBackRef,
+										  UBaseType_t uxLevel );
+
+/* Turn a line installed with xDeferredWorkInstallInterrupt() off or on from
+ * task context. After a disable the bottom half leaves the line masked, and
+ * an enable made while a bottom half is pending is left to that bottom half. */
+void vDeferredWorkDisableInterrupt( DeferredIrq_t * pxIrq );
+void vDeferredWorkEnableInterrupt( DeferredIrq_t * pxIrq );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEFERRED_WORK_H */
@@ -156,6 +156,10 @@ debugger. */
 registers, plus a 32-bit status register. */
 #define portFPU_REGISTER_WORDS  ( ( 32 * 2 ) + 1 )
 
+/* With lazy FPU switching each task's FPU registers live in an area at the top
+of its stack, padded to keep the stack 8 byte aligned. */
+#define portFPU_LAZY_CONTEXT_WORDS  ( portFPU_REGISTER_WORDS + 1 )
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -223,6 +227,17 @@ volatile uint32_t ulCriticalNesting = 9999UL;
 a floating point context must be saved and restored for the task. */
 volatile uint32_t ulPortTaskHasFPUContext = pdFALSE;
 
+#if( configUSE_TASK_FPU_SUPPORT == 3 )
+    /* With lazy FPU switching ulPortTaskHasFPUContext instead holds the address
+    of the running task's FPU save area.  ulPortFPUOwnerContext is the save area
+    of the task whose registers are currently loaded in the FPU, and
+    pxPortFPUOwnerTCB that task's TCB.  ulPortFPUSwitches counts the times the
+    FPU changed hands. */
+    volatile uint32_t ulPortFPUOwnerContext = 0UL;
+    void * volatile pxPortFPUOwnerTCB = NULL;
+    volatile uint32_t ulPortFPUSwitches = 0UL;
+#endif
+
 /* Set to 1 to pend a context switch from an ISR. */
 volatile uint32_t ulPortYieldRequired = pdFALSE;
 
@@ -250,6 +265,16 @@ __attribute__(( used )) const uint32_t ulMaxAPIPriorityMask = ( configMAX_API_CA
  */
 StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
 {
+#if( configUSE_TASK_FPU_SUPPORT == 3 )
+StackType_t *pxFPUContext;
+
+    /* Reserve the task's FPU save area above everything else, it has to stay
+    put for the life of the task. */
+    pxFPUContext = pxTopOfStack - portFPU_LAZY_CONTEXT_WORDS;
+    memset( pxFPUContext, 0x00, portFPU_LAZY_CONTEXT_WORDS * sizeof( StackType_t ) );
+    pxTopOfStack = pxFPUContext - 2;
+#endif
+
     /* Setup the initial stack of the task.  The stack is set exactly as
     expected by the portRESTORE_CONTEXT() macro.
 
@@ -329,9 +354,16 @@ StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t px
         *pxTopOfStack = pdTRUE;
         ulPortTaskHasFPUContext = pdTRUE;
     }
+    #elif( configUSE_TASK_FPU_SUPPORT == 3 )
+    {
+        /* The task starts without the FPU.  Its first FPU instruction traps
+        and loads the zeroed save area. */
+        pxTopOfStack--;
+        *pxTopOfStack = ( StackType_t ) pxFPUContext;
+    }
     #else
     {
-        #error Invalid configUSE_TASK_FPU_SUPPORT setting - configUSE_TASK_FPU_SUPPORT must be set to 1, 2, or left undefined.
+        #error Invalid configUSE_TASK_FPU_SUPPORT setting - configUSE_TASK_FPU_SUPPORT must be set to 1, 2, 3, or left undefined.
     }
     #endif
 
@@ -653,7 +685,7 @@ void FreeRTOS_Tick_Handler( void )
 }
 /*-----------------------------------------------------------*/
 
-#if( configUSE_TASK_FPU_SUPPORT != 2 )
+#if( ( configUSE_TASK_FPU_SUPPORT != 2 ) && ( configUSE_TASK_FPU_SUPPORT != 3 ) )
 
     void vPortTaskUsesFPU( void )
     {
@@ -670,6 +702,26 @@ void FreeRTOS_Tick_Handler( void )
 #endif /* configUSE_TASK_FPU_SUPPORT */
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TASK_FPU_SUPPORT == 3 )
+
+    void vPortCleanUpTaskFPU( void *pxTCB )
+    {
+        /* Forget a deleted task's registers rather than later saving them
+        into a stack that has been freed. */
+        portENTER_CRITICAL();
+        {
+            if( pxPortFPUOwnerTCB == pxTCB )
+            {
+                pxPortFPUOwnerTCB = NULL;
+                ulPortFPUOwnerContext = 0UL;
+            }
+        }
+        portEXIT_CRITICAL();
+    }
+
+#endif /* configUSE_TASK_FPU_SUPPORT */
+/*-----------------------------------------------------------*/
+
 void vPortClearInterruptMask( uint32_t ulNewMaskValue )
 {
     if( ulNewMaskValue == pdFALSE )
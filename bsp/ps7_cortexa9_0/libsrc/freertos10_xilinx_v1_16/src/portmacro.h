@@ -181,8 +181,9 @@ void vPortDisableInterrupt( uint16_t ucInterruptID );
 created without an FPU context and must call vPortTaskUsesFPU() to give
 themselves an FPU context before using any FPU instructions.  If
 configUSE_TASK_FPU_SUPPORT is set to 2 then all tasks will have an FPU context
-by default. */
-#if( configUSE_TASK_FPU_SUPPORT != 2 )
+by default.  If configUSE_TASK_FPU_SUPPORT is set to 3 then all tasks also have
+an FPU context, but it is only saved and restored when the FPU changes hands. */
+#if( ( configUSE_TASK_FPU_SUPPORT != 2 ) && ( configUSE_TASK_FPU_SUPPORT != 3 ) )
     void vPortTaskUsesFPU( void );
 #else
     /* Each task has an FPU context already, so define this function away to
@@ -191,6 +192,13 @@ by default. */
 #endif
 #define portTASK_USES_FLOATING_POINT() vPortTaskUsesFPU()
 
+#if( configUSE_TASK_FPU_SUPPORT == 3 )
+    /* A deleted task must stop being the FPU owner before its stack, which
+    holds its saved FPU registers, is freed. */
+    void vPortCleanUpTaskFPU( void *pxTCB );
+    #define portCLEAN_UP_TCB( pxTCB ) vPortCleanUpTaskFPU( pxTCB )
+#endif
+
 #define portLOWEST_INTERRUPT_PRIORITY ( ( ( uint32_t ) configUNIQUE_INTERRUPT_PRIORITIES ) - 1UL )
 #define portLOWEST_USABLE_INTERRUPT_PRIORITY ( portLOWEST_INTERRUPT_PRIORITY - 1UL )
 
@@ -50,13 +50,44 @@ extern "C" {
 #include "semphr.h"
 #include "timers.h"
 
+/*
+ * When set, mailboxes and semaphores come from sys_arch_notify.c: lock-free
+ * rings and direct-to-task notifications on index
+ * LWIP_SYS_ARCH_NOTIFY_INDEX, instead of FreeRTOS queues. Both only allow
+ * one task to block on them at a time, which is how lwIP uses them.
+ */
+#ifndef LWIP_SYS_ARCH_NOTIFY
+#define LWIP_SYS_ARCH_NOTIFY			1
+#endif
+
+#ifndef LWIP_SYS_ARCH_NOTIFY_INDEX
+#define LWIP_SYS_ARCH_NOTIFY_INDEX		1
+#endif
+
+#if LWIP_SYS_ARCH_NOTIFY
+#if LWIP_SYS_ARCH_NOTIFY_INDEX >= configTASK_NOTIFICATION_ARRAY_ENTRIES
+#error LWIP_SYS_ARCH_NOTIFY_INDEX needs a spare configTASK_NOTIFICATION_ARRAY_ENTRIES slot
+#endif
+
+struct sys_mbox_s;
+struct sys_sem_s;
+
+#define SYS_MBOX_NULL					( ( struct sys_mbox_s * ) NULL )
+#define SYS_SEM_NULL					( ( struct sys_sem_s * ) NULL )
+
+typedef struct sys_sem_s *sys_sem_t;
+typedef struct sys_mbox_s *sys_mbox_t;
+#else
 #define SYS_MBOX_NULL					( ( xQueueHandle ) NULL )
 #define SYS_SEM_NULL					( ( xSemaphoreHandle ) NULL )
-#define SYS_DEFAULT_THREAD_STACK_DEPTH	configMINIMAL_STACK_SIZE
 
 typedef xSemaphoreHandle sys_sem_t;
-typedef xSemaphoreHandle sys_mutex_t;
 typedef xQueueHandle sys_mbox_t;
+#endif /* LWIP_SYS_ARCH_NOTIFY */
+
+#define SYS_DEFAULT_THREAD_STACK_DEPTH	configMINIMAL_STACK_SIZE
+
+typedef xSemaphoreHandle sys_mutex_t;
 typedef xTaskHandle sys_thread_t;
 
 typedef unsigned long sys_prot_t;
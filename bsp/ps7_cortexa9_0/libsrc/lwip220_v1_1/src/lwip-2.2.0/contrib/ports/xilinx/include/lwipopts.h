@@ -119,6 +119,19 @@
 #define LWIP_FULL_CSUM_OFFLOAD_RX  1
 #define LWIP_FULL_CSUM_OFFLOAD_TX  1
 
+/* Large pbuf copies use the BSP's NEON memcpy on the Cortex-A9. It falls
+ * back to memcpy() when called from an interrupt handler. */
+#include "xil_types.h"
+#include "xil_mem.h"
+#ifdef XIL_MEM_NEON
+#define MEMCPY(dst, src, len) Xil_MemCpyNeon(dst, src, len)
+#endif
+
+/* The pools and the heap are set up by memp_init() and mem_init(), so keep
+ * the few MB they take out of .bss and the startup clear */
+#define LWIP_DECLARE_MEMORY_ALIGNED(variable_name, size) \
+	u8_t variable_name[LWIP_MEM_ALIGN_BUFFER(size)] __attribute__ ((section (".noinit")))
+
 #define MEMP_SEPARATE_POOLS 1
 #define MEMP_NUM_FRAG_PBUF 256
 #define IP_OPTIONS_ALLOWED 0
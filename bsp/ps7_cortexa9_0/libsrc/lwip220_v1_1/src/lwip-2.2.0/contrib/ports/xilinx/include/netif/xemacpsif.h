@@ -112,6 +112,21 @@ extern "C" {
 
 #define MAX_FRAME_SIZE_JUMBO (XEMACPS_MTU_JUMBO + XEMACPS_HDR_SIZE + XEMACPS_TRL_SIZE)
 
+/* Run the GEM interrupt handler in a deferred-work task (deferred_work.h in
+ * the FreeRTOS BSP) rather than in interrupt context. The real interrupt
+ * only masks the GEM line and wakes the worker. */
+#ifndef XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
+#if !NO_SYS && !defined(SDT) && defined(__arm__) && !defined(ARMR5)
+#define XLWIP_CONFIG_EMACPS_DEFERRED_IRQ 1
+#else
+#define XLWIP_CONFIG_EMACPS_DEFERRED_IRQ 0
+#endif
+#endif
+
+#if XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
+#include "deferred_work.h"
+#endif
+
 void 	xemacpsif_setmac(u32_t index, u8_t *addr);
 u8_t*	xemacpsif_getmac(u32_t index);
 err_t 	xemacpsif_init(struct netif *netif);
@@ -136,6 +151,9 @@ typedef struct {
 
 	unsigned int last_rx_frms_cntr;
 	enum ethernet_link_status eth_link_status;
+#if XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
+	DeferredIrq_t deferred_irq;
+#endif
 } xemacpsif_s;
 
 extern xemacpsif_s xemacpsif;
@@ -71,6 +71,9 @@ static UINTPTR rx_pbufs_storage[4*XLWIP_CONFIG_N_RX_DESC];
 
 #ifndef SDT
 static s32_t emac_intr_num;
+#if XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
+static DeferredIrq_t *emac_deferred_irq;
+#endif
 #endif
 
 #if LWIP_UDP_OPT_BLOCK_TX_TILL_COMPLETE
@@ -120,6 +123,15 @@ volatile u32_t notifyinfo[4*XLWIP_CONFIG_N_TX_DESC];
 
 #if defined __aarch64__
 u8_t emac_bd_space[0x200000] __attribute__ ((aligned (0x200000)));
+#elif defined (XIL_MMU_PAGE_SIZE) && defined (XPAR_XEMACPS_NUM_INSTANCES)
+/*
+ * The Cortex-A9 xil_mmu.c can set attributes on 4 KB pages, so only the
+ * 256 KB each GEM can use (four 64 KB BD chains) is set aside, and it doesn't
+ * need to be 1 MB aligned. XEmacPs_BdRingCreate() clears the rings, so the
+ * space is left out of the startup BSS clear.
+ */
+#define EMAC_BD_SPACE_SIZE	(0x40000 * XPAR_XEMACPS_NUM_INSTANCES)
+u8_t emac_bd_space[EMAC_BD_SPACE_SIZE] __attribute__ ((aligned (XIL_MMU_PAGE_SIZE), section (".noinit")));
 #else
 u8_t emac_bd_space[0x100000] __attribute__ ((aligned (0x100000)));
 #endif
@@ -298,7 +310,7 @@ void emacps_send_handler(void *arg)
 	xemacpsif_s   *xemacpsif;
 	XEmacPs_BdRing *txringptr;
 	u32_t regval;
-#if !NO_SYS
+#if !NO_SYS && !XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
 	xInsideISR++;
 #endif
 	xemac = (struct xemac_s *)(arg);
@@ -309,7 +321,7 @@ void emacps_send_handler(void *arg)
 
 	/* If Transmit done interrupt is asserted, process completed BD's */
 	xemacps_process_sent_bds(xemacpsif, txringptr);
-#if !NO_SYS
+#if !NO_SYS && !XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
 	xInsideISR--;
 #endif
 }
@@ -517,7 +529,7 @@ void emacps_recv_handler(void *arg)
 	xemacpsif = (xemacpsif_s *)(xemac->state);
 	rxring = &XEmacPs_GetRxRing(&xemacpsif->emacps);
 
-#if !NO_SYS
+#if !NO_SYS && !XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
 	xInsideISR++;
 #endif
 
@@ -580,7 +592,9 @@ void emacps_recv_handler(void *arg)
 	}
 #if !NO_SYS
 	sys_sem_signal(&xemac->sem_rx_data_available);
+#if !XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
 	xInsideISR--;
+#endif
 #endif
 
 	return;
@@ -642,6 +656,13 @@ XStatus init_dma(struct xemac_s *xemac)
 #else
 #if defined __aarch64__
 	Xil_SetTlbAttributes((u64)emac_bd_space, NORM_NONCACHE | INNER_SHAREABLE);
+#elif defined (EMAC_BD_SPACE_SIZE)
+	if (Xil_SetTlbAttributesRange((INTPTR)emac_bd_space, sizeof(emac_bd_space),
+				DEVICE_MEMORY) != XST_SUCCESS) {
+		xil_printf("%s@%d: Error: Unable to make BD space uncached\r\n",
+				__FILE__, __LINE__);
+		return ERR_IF;
+	}
 #else
 	Xil_SetTlbAttributes((s32_t)emac_bd_space, DEVICE_MEMORY); // addr, attr
 #endif
@@ -811,6 +832,11 @@ XStatus init_dma(struct xemac_s *xemac)
 	xPortInstallInterruptHandler(xemacpsif->emacps.Config.IntrId,
 				     ( Xil_InterruptHandler ) XEmacPs_IntrHandler,
 				     (void *)&xemacpsif->emacps);
+#elif XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
+	xDeferredWorkInstallInterrupt(&xemacpsif->deferred_irq, xtopologyp->scugic_emac_intr,
+				      ( Xil_InterruptHandler ) XEmacPs_IntrHandler,
+				      (void *)&xemacpsif->emacps, deferredworkLEVEL_HIGH);
+	emac_deferred_irq = &xemacpsif->deferred_irq;
 #else
 	xPortInstallInterruptHandler(xtopologyp->scugic_emac_intr,
 				     ( Xil_InterruptHandler ) XEmacPs_IntrHandler,
@@ -946,11 +972,20 @@ void reset_dma(struct xemac_s *xemac)
 #ifndef SDT
 void emac_disable_intr(void)
 {
+#if XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
+	/* So the bottom half doesn't turn the line back on */
+	vDeferredWorkDisableInterrupt(emac_deferred_irq);
+#else
 	XScuGic_DisableIntr(INTC_DIST_BASE_ADDR, emac_intr_num);
+#endif
 }
 
 void emac_enable_intr(void)
 {
+#if XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
+	vDeferredWorkEnableInterrupt(emac_deferred_irq);
+#else
 	XScuGic_EnableIntr(INTC_DIST_BASE_ADDR, emac_intr_num);
+#endif
 }
 #endif
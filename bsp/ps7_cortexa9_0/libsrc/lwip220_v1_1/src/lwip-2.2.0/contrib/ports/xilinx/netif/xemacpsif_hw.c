@@ -227,7 +227,7 @@ void emacps_error_handler(void *arg,u8 Direction, u32 ErrorWord)
 	xemacpsif_s   *xemacpsif;
 	XEmacPs_BdRing *rxring;
 	XEmacPs_BdRing *txring;
-#if !NO_SYS
+#if !NO_SYS && !XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
 	xInsideISR++;
 #endif
 
@@ -278,7 +278,7 @@ void emacps_error_handler(void *arg,u8 Direction, u32 ErrorWord)
 			break;
 		}
 	}
-#if !NO_SYS
+#if !NO_SYS && !XLWIP_CONFIG_EMACPS_DEFERRED_IRQ
 	xInsideISR--;
 #endif
 }
@@ -59,6 +59,8 @@ functions are being called from an interrupt context or not.  This relies on
 the interrupt handler setting this variable manually. */
 u32 xInsideISR;
 
+#if !LWIP_SYS_ARCH_NOTIFY
+
 /*---------------------------------------------------------------------------*
  * Routine:  sys_mbox_new
  *---------------------------------------------------------------------------*
@@ -448,6 +450,8 @@ portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 	return ulReturn;
 }
 
+#endif /* !LWIP_SYS_ARCH_NOTIFY */
+
 /** Create a new mutex
  * @param mutex pointer to the mutex to create
  * @return a new mutex */
@@ -510,6 +514,8 @@ void sys_mutex_free( sys_mutex_t *pxMutex )
 }
 
 
+#if !LWIP_SYS_ARCH_NOTIFY
+
 /*---------------------------------------------------------------------------*
  * Routine:  sys_sem_signal
  *---------------------------------------------------------------------------*
@@ -549,6 +555,8 @@ void sys_sem_free( sys_sem_t *pxSemaphore )
 	vQueueDelete( *pxSemaphore );
 }
 
+#endif /* !LWIP_SYS_ARCH_NOTIFY */
+
 /*---------------------------------------------------------------------------*
  * Routine:  sys_init
  *---------------------------------------------------------------------------*
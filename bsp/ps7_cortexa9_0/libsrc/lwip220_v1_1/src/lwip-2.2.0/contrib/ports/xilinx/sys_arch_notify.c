@@ -0,0 +1,598 @@
+/*
+ * lwIP mailboxes and semaphores built on direct-to-task notifications.
+ *
+ * A FreeRTOS queue carries its own event lists, a mutex-like lock and a
+ * copy-in/copy-out path for every item. lwIP only ever moves pointers, and
+ * only one task at a time blocks on any of its mailboxes or semaphores, so
+ * this backend keeps just enough state for that:
+ *
+ *  - A mailbox is a bounded ring of pointers with per-cell sequence numbers
+ *    (D. Vyukov's bounded MPMC queue). Posting and fetching are a single
+ *    compare-and-swap each, safe from tasks and ISRs without a critical
+ *    section.
+ *  - A semaphore is a binary flag, matching the binary semaphores the queue
+ *    backend in sys_arch.c creates.
+ *  - A task that has to block records itself as the waiter and sleeps in
+ *    ulTaskNotifyTakeIndexed(). Whoever makes the object ready swaps the
+ *    waiter out and notifies it. The waiter always re-checks the object after
+ *    waking, so a stale or spurious notification only costs a loop.
+ *
+ * Selected by LWIP_SYS_ARCH_NOTIFY in arch/sys_arch.h; mutexes, threads and
+ * time stay in sys_arch.c.
+ */
+
+#include "lwipopts.h"
+
+#if !NO_SYS
+
+#include "arch/sys_arch.h"
+
+#if LWIP_SYS_ARCH_NOTIFY
+
+/* ------------------------ lwIP includes --------------------------------- */
+#include "lwip/opt.h"
+
+#include "lwip/debug.h"
+#include "lwip/def.h"
+#include "lwip/sys.h"
+#include "lwip/mem.h"
+#include "lwip/stats.h"
+
+/* Set around interrupt handlers by the Xilinx adapters, see sys_arch.c */
+extern u32 xInsideISR;
+
+typedef struct {
+	u32_t ulSequence;
+	void *pvMessage;
+} MboxCell_t;
+
+struct sys_mbox_s {
+	MboxCell_t *pxCells;
+	u32_t ulMask;
+	u32_t ulHead;
+	u32_t ulTail;
+	TaskHandle_t xWaiter;
+};
+
+struct sys_sem_s {
+	u32_t ulSignalled;
+	TaskHandle_t xWaiter;
+};
+
+/*---------------------------------------------------------------------------*
+ * Waiter handling
+ *---------------------------------------------------------------------------*/
+
+/* Wake whoever is blocked on an object that just became ready */
+static void prvWakeWaiter( TaskHandle_t *pxWaiter )
+{
+TaskHandle_t xWaiter;
+portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	xWaiter = __atomic_exchange_n( pxWaiter, NULL, __ATOMIC_SEQ_CST );
+	if( xWaiter == NULL )
+	{
+		return;
+	}
+
+	if( xInsideISR != pdFALSE )
+	{
+		vTaskNotifyGiveIndexedFromISR( xWaiter, LWIP_SYS_ARCH_NOTIFY_INDEX, &xHigherPriorityTaskWoken );
+		portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+	}
+	else
+	{
+		xTaskNotifyGiveIndexed( xWaiter, LWIP_SYS_ARCH_NOTIFY_INDEX );
+	}
+}
+
+/*
+ * Register the calling task as the waiter. Returns pdFALSE when the object
+ * became ready in the meantime (per xReady), in which case nothing is left
+ * registered and the caller should just retry its fast path.
+ */
+static portBASE_TYPE prvArmWaiter( TaskHandle_t *pxWaiter, portBASE_TYPE ( *xReady )( void * ), void *pvObject )
+{
+	/* lwIP never has two tasks blocking on one mailbox or semaphore */
+	configASSERT( __atomic_load_n( pxWaiter, __ATOMIC_RELAXED ) == NULL );
+
+	__atomic_store_n( pxWaiter, xTaskGetCurrentTaskHandle(), __ATOMIC_SEQ_CST );
+
+	if( xReady( pvObject ) != pdFALSE )
+	{
+		/* If a producer already swapped us out, its notification is pending
+		 * and has to be consumed so it doesn't wake a later wait early */
+		if( __atomic_exchange_n( pxWaiter, NULL, __ATOMIC_SEQ_CST ) == NULL )
+		{
+			ulTaskNotifyTakeIndexed( LWIP_SYS_ARCH_NOTIFY_INDEX, pdTRUE, 0 );
+		}
+		return pdFALSE;
+	}
+
+	return pdTRUE;
+}
+
+/* Unregister after a wait timed out, consuming a notification that raced
+ * with the timeout */
+static void prvDisarmWaiter( TaskHandle_t *pxWaiter )
+{
+	if( __atomic_exchange_n( pxWaiter, NULL, __ATOMIC_SEQ_CST ) == NULL )
+	{
+		ulTaskNotifyTakeIndexed( LWIP_SYS_ARCH_NOTIFY_INDEX, pdTRUE, 0 );
+	}
+}
+
+static u32_t prvElapsedMs( portTickType xStartTime )
+{
+	return ( xTaskGetTickCount() - xStartTime ) * portTICK_RATE_MS;
+}
+
+/*---------------------------------------------------------------------------*
+ * Ring
+ *---------------------------------------------------------------------------*/
+
+static portBASE_TYPE prvMboxPush( struct sys_mbox_s *pxMbox, void *pvMessage )
+{
+MboxCell_t *pxCell;
+u32_t ulPos, ulSeq;
+s32_t lDiff;
+
+	ulPos = __atomic_load_n( &pxMbox->ulTail, __ATOMIC_RELAXED );
+
+	for( ;; )
+	{
+		pxCell = &pxMbox->pxCells[ ulPos & pxMbox->ulMask ];
+		ulSeq = __atomic_load_n( &pxCell->ulSequence, __ATOMIC_ACQUIRE );
+		lDiff = ( s32_t ) ( ulSeq - ulPos );
+
+		if( lDiff == 0 )
+		{
+			/* Cell is free for this lap, try to claim it */
+			if( __atomic_compare_exchange_n( &pxMbox->ulTail, &ulPos, ulPos + 1, pdTRUE,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+			{
+				break;
+			}
+		}
+		else if( lDiff < 0 )
+		{
+			/* Consumer hasn't freed this cell yet: full */
+			return pdFALSE;
+		}
+		else
+		{
+			ulPos = __atomic_load_n( &pxMbox->ulTail, __ATOMIC_RELAXED );
+		}
+	}
+
+	pxCell->pvMessage = pvMessage;
+	__atomic_store_n( &pxCell->ulSequence, ulPos + 1, __ATOMIC_RELEASE );
+
+	return pdTRUE;
+}
+
+static portBASE_TYPE prvMboxPop( struct sys_mbox_s *pxMbox, void **ppvMessage )
+{
+MboxCell_t *pxCell;
+u32_t ulPos, ulSeq;
+s32_t lDiff;
+
+	ulPos = __atomic_load_n( &pxMbox->ulHead, __ATOMIC_RELAXED );
+
+	for( ;; )
+	{
+		pxCell = &pxMbox->pxCells[ ulPos & pxMbox->ulMask ];
+		ulSeq = __atomic_load_n( &pxCell->ulSequence, __ATOMIC_ACQUIRE );
+		lDiff = ( s32_t ) ( ulSeq - ( ulPos + 1 ) );
+
+		if( lDiff == 0 )
+		{
+			if( __atomic_compare_exchange_n( &pxMbox->ulHead, &ulPos, ulPos + 1, pdTRUE,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+			{
+				break;
+			}
+		}
+		else if( lDiff < 0 )
+		{
+			/* Nothing published in this cell yet: empty */
+			return pdFALSE;
+		}
+		else
+		{
+			ulPos = __atomic_load_n( &pxMbox->ulHead, __ATOMIC_RELAXED );
+		}
+	}
+
+	*ppvMessage = pxCell->pvMessage;
+	__atomic_store_n( &pxCell->ulSequence, ulPos + pxMbox->ulMask + 1, __ATOMIC_RELEASE );
+
+	return pdTRUE;
+}
+
+static portBASE_TYPE prvMboxNotEmpty( void *pvMbox )
+{
+struct sys_mbox_s *pxMbox = pvMbox;
+u32_t ulPos = __atomic_load_n( &pxMbox->ulHead, __ATOMIC_RELAXED );
+MboxCell_t *pxCell = &pxMbox->pxCells[ ulPos & pxMbox->ulMask ];
+
+	return __atomic_load_n( &pxCell->ulSequence, __ATOMIC_ACQUIRE ) == ulPos + 1;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_mbox_new
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Creates a new mailbox. The ring is rounded up to a power of two,
+ *      and needs at least two cells for the sequence numbers to work.
+ * Inputs:
+ *      int size                -- Size of elements in the mailbox
+ * Outputs:
+ *      sys_mbox_t              -- Handle to new mailbox
+ *---------------------------------------------------------------------------*/
+err_t sys_mbox_new( sys_mbox_t *pxMailBox, int iSize )
+{
+struct sys_mbox_s *pxMbox;
+u32_t ulCells = 2, i;
+
+	while( ulCells < ( u32_t ) iSize )
+	{
+		ulCells <<= 1;
+	}
+
+	pxMbox = pvPortMalloc( sizeof( *pxMbox ) );
+	if( pxMbox == NULL )
+	{
+		SYS_STATS_INC( mbox.err );
+		return ERR_MEM;
+	}
+
+	pxMbox->pxCells = pvPortMalloc( ulCells * sizeof( MboxCell_t ) );
+	if( pxMbox->pxCells == NULL )
+	{
+		vPortFree( pxMbox );
+		SYS_STATS_INC( mbox.err );
+		return ERR_MEM;
+	}
+
+	for( i = 0; i < ulCells; i++ )
+	{
+		pxMbox->pxCells[ i ].ulSequence = i;
+	}
+
+	pxMbox->ulMask = ulCells - 1;
+	pxMbox->ulHead = 0;
+	pxMbox->ulTail = 0;
+	pxMbox->xWaiter = NULL;
+
+	*pxMailBox = pxMbox;
+	SYS_STATS_INC_USED( mbox );
+
+	return ERR_OK;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_mbox_free
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Deallocates a mailbox. If there are messages still present in the
+ *      mailbox when the mailbox is deallocated, it is an indication of a
+ *      programming error in lwIP and the developer should be notified.
+ * Inputs:
+ *      sys_mbox_t mbox         -- Handle of mailbox
+ *---------------------------------------------------------------------------*/
+void sys_mbox_free( sys_mbox_t *pxMailBox )
+{
+struct sys_mbox_s *pxMbox = *pxMailBox;
+portBASE_TYPE xNotEmpty = prvMboxNotEmpty( pxMbox );
+
+	configASSERT( xNotEmpty == pdFALSE );
+
+	#if SYS_STATS
+	{
+		if( xNotEmpty != pdFALSE )
+		{
+			SYS_STATS_INC( mbox.err );
+		}
+
+		SYS_STATS_DEC( mbox.used );
+	}
+	#endif /* SYS_STATS */
+
+	vPortFree( pxMbox->pxCells );
+	vPortFree( pxMbox );
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_mbox_post
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Post the "msg" to the mailbox, waiting for space if it is full.
+ *      Only producers contend for space and lwIP sizes its mailboxes so
+ *      that this is rare, so a full mailbox is waited out a tick at a time
+ *      rather than by keeping a second waiter list.
+ * Inputs:
+ *      sys_mbox_t mbox         -- Handle of mailbox
+ *      void *data              -- Pointer to data to post
+ *---------------------------------------------------------------------------*/
+void sys_mbox_post( sys_mbox_t *pxMailBox, void *pxMessageToPost )
+{
+	while( prvMboxPush( *pxMailBox, pxMessageToPost ) == pdFALSE )
+	{
+		configASSERT( xInsideISR == pdFALSE );
+		vTaskDelay( 1 );
+	}
+
+	prvWakeWaiter( &( *pxMailBox )->xWaiter );
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_mbox_trypost
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Try to post the "msg" to the mailbox.  Returns immediately with
+ *      error if cannot.
+ * Inputs:
+ *      sys_mbox_t mbox         -- Handle of mailbox
+ *      void *msg               -- Pointer to data to post
+ * Outputs:
+ *      err_t                   -- ERR_OK if message posted, else ERR_MEM
+ *                                  if not.
+ *---------------------------------------------------------------------------*/
+err_t sys_mbox_trypost( sys_mbox_t *pxMailBox, void *pxMessageToPost )
+{
+	if( prvMboxPush( *pxMailBox, pxMessageToPost ) == pdFALSE )
+	{
+		LWIP_DEBUGF(NETIF_DEBUG, ("Queue is full\r\n"));
+		SYS_STATS_INC( mbox.err );
+		return ERR_MEM;
+	}
+
+	prvWakeWaiter( &( *pxMailBox )->xWaiter );
+
+	return ERR_OK;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_arch_mbox_fetch
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Blocks the thread until a message arrives in the mailbox, but does
+ *      not block the thread longer than "timeout" milliseconds. From an ISR
+ *      this never blocks.
+ * Inputs:
+ *      sys_mbox_t mbox         -- Handle of mailbox
+ *      void **msg              -- Pointer to pointer to msg received
+ *      u32_t timeout           -- Number of milliseconds until timeout,
+ *                                  0 to wait forever
+ * Outputs:
+ *      u32_t                   -- SYS_ARCH_TIMEOUT if timeout, else number
+ *                                  of milliseconds until received.
+ *---------------------------------------------------------------------------*/
+u32_t sys_arch_mbox_fetch( sys_mbox_t *pxMailBox, void **ppvBuffer, u32_t ulTimeOut )
+{
+struct sys_mbox_s *pxMbox = *pxMailBox;
+void *pvDummy;
+portTickType xStartTime, xTicksToWait;
+TimeOut_t xTimeOut;
+u32_t ulElapsed;
+
+	if( NULL == ppvBuffer )
+	{
+		ppvBuffer = &pvDummy;
+	}
+
+	xStartTime = xTaskGetTickCount();
+	xTicksToWait = ( ulTimeOut != 0UL ) ? ulTimeOut / portTICK_RATE_MS : portMAX_DELAY;
+	vTaskSetTimeOutState( &xTimeOut );
+
+	while( prvMboxPop( pxMbox, ppvBuffer ) == pdFALSE )
+	{
+		if( ( xInsideISR != pdFALSE ) ||
+			( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE ) )
+		{
+			*ppvBuffer = NULL;
+			return SYS_ARCH_TIMEOUT;
+		}
+
+		if( prvArmWaiter( &pxMbox->xWaiter, prvMboxNotEmpty, pxMbox ) == pdFALSE )
+		{
+			continue;
+		}
+
+		if( ulTaskNotifyTakeIndexed( LWIP_SYS_ARCH_NOTIFY_INDEX, pdTRUE, xTicksToWait ) != 0 )
+		{
+			/* Normally the waker already cleared this. After a stale
+			 * notification from an earlier wait it still names us. */
+			__atomic_store_n( &pxMbox->xWaiter, NULL, __ATOMIC_SEQ_CST );
+		}
+		else
+		{
+			prvDisarmWaiter( &pxMbox->xWaiter );
+		}
+	}
+
+	ulElapsed = prvElapsedMs( xStartTime );
+
+	/* Waiting forever reports at least 1ms, like the queue backend */
+	if( ( ulTimeOut == 0UL ) && ( ulElapsed == 0UL ) )
+	{
+		ulElapsed = 1UL;
+	}
+
+	return ulElapsed;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_arch_mbox_tryfetch
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Similar to sys_arch_mbox_fetch, but if message is not ready
+ *      immediately, we'll return with SYS_MBOX_EMPTY.  On success, 0 is
+ *      returned.
+ * Inputs:
+ *      sys_mbox_t mbox         -- Handle of mailbox
+ *      void **msg              -- Pointer to pointer to msg received
+ * Outputs:
+ *      u32_t                   -- SYS_MBOX_EMPTY if no messages.  Otherwise,
+ *                                  return ERR_OK.
+ *---------------------------------------------------------------------------*/
+u32_t sys_arch_mbox_tryfetch( sys_mbox_t *pxMailBox, void **ppvBuffer )
+{
+void *pvDummy;
+
+	if( ppvBuffer == NULL )
+	{
+		ppvBuffer = &pvDummy;
+	}
+
+	if( prvMboxPop( *pxMailBox, ppvBuffer ) == pdFALSE )
+	{
+		return SYS_MBOX_EMPTY;
+	}
+
+	return ERR_OK;
+}
+
+/*---------------------------------------------------------------------------*
+ * Semaphores
+ *---------------------------------------------------------------------------*/
+
+static portBASE_TYPE prvSemTryTake( struct sys_sem_s *pxSem )
+{
+	return __atomic_exchange_n( &pxSem->ulSignalled, 0, __ATOMIC_ACQUIRE ) != 0 ? pdTRUE : pdFALSE;
+}
+
+static portBASE_TYPE prvSemIsSignalled( void *pvSem )
+{
+struct sys_sem_s *pxSem = pvSem;
+
+	return __atomic_load_n( &pxSem->ulSignalled, __ATOMIC_ACQUIRE ) != 0 ? pdTRUE : pdFALSE;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_sem_new
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Creates and returns a new semaphore. The "ucCount" argument specifies
+ *      the initial state of the semaphore; any non-zero count is treated as
+ *      signalled.
+ * Inputs:
+ *      u8_t ucCount            -- Initial ucCount of semaphore (1 or 0)
+ * Outputs:
+ *      sys_sem_t               -- Created semaphore or 0 if could not create.
+ *---------------------------------------------------------------------------*/
+err_t sys_sem_new( sys_sem_t *pxSemaphore, u8_t ucCount )
+{
+struct sys_sem_s *pxSem;
+
+	pxSem = pvPortMalloc( sizeof( *pxSem ) );
+	if( pxSem == NULL )
+	{
+		LWIP_DEBUGF(SYS_DEBUG, ("Sem creation error\r\n"));
+		SYS_STATS_INC( sem.err );
+		return ERR_MEM;
+	}
+
+	pxSem->ulSignalled = ( ucCount != 0 ) ? 1 : 0;
+	pxSem->xWaiter = NULL;
+
+	*pxSemaphore = pxSem;
+	SYS_STATS_INC_USED( sem );
+
+	return ERR_OK;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_arch_sem_wait
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Blocks the thread while waiting for the semaphore to be
+ *      signaled. If the "timeout" argument is non-zero, the thread should
+ *      only be blocked for the specified time (measured in
+ *      milliseconds). From an ISR this never blocks.
+ * Inputs:
+ *      sys_sem_t sem           -- Semaphore to wait on
+ *      u32_t timeout           -- Number of milliseconds until timeout
+ * Outputs:
+ *      u32_t                   -- Time elapsed or SYS_ARCH_TIMEOUT.
+ *---------------------------------------------------------------------------*/
+u32_t sys_arch_sem_wait( sys_sem_t *pxSemaphore, u32_t ulTimeout )
+{
+struct sys_sem_s *pxSem = *pxSemaphore;
+portTickType xStartTime, xTicksToWait;
+TimeOut_t xTimeOut;
+u32_t ulElapsed;
+
+	xStartTime = xTaskGetTickCount();
+	xTicksToWait = ( ulTimeout != 0UL ) ? ulTimeout / portTICK_RATE_MS : portMAX_DELAY;
+	vTaskSetTimeOutState( &xTimeOut );
+
+	while( prvSemTryTake( pxSem ) == pdFALSE )
+	{
+		if( ( xInsideISR != pdFALSE ) ||
+			( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE ) )
+		{
+			return SYS_ARCH_TIMEOUT;
+		}
+
+		if( prvArmWaiter( &pxSem->xWaiter, prvSemIsSignalled, pxSem ) == pdFALSE )
+		{
+			continue;
+		}
+
+		if( ulTaskNotifyTakeIndexed( LWIP_SYS_ARCH_NOTIFY_INDEX, pdTRUE, xTicksToWait ) != 0 )
+		{
+			/* Normally the waker already cleared this. After a stale
+			 * notification from an earlier wait it still names us. */
+			__atomic_store_n( &pxSem->xWaiter, NULL, __ATOMIC_SEQ_CST );
+		}
+		else
+		{
+			prvDisarmWaiter( &pxSem->xWaiter );
+		}
+	}
+
+	ulElapsed = prvElapsedMs( xStartTime );
+
+	if( ( ulTimeout == 0UL ) && ( ulElapsed == 0UL ) )
+	{
+		ulElapsed = 1UL;
+	}
+
+	return ulElapsed;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_sem_signal
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Signals (releases) a semaphore
+ * Inputs:
+ *      sys_sem_t sem           -- Semaphore to signal
+ *---------------------------------------------------------------------------*/
+void sys_sem_signal( sys_sem_t *pxSemaphore )
+{
+struct sys_sem_s *pxSem = *pxSemaphore;
+
+	__atomic_store_n( &pxSem->ulSignalled, 1, __ATOMIC_RELEASE );
+	prvWakeWaiter( &pxSem->xWaiter );
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  sys_sem_free
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Deallocates a semaphore
+ * Inputs:
+ *      sys_sem_t sem           -- Semaphore to free
+ *---------------------------------------------------------------------------*/
+void sys_sem_free( sys_sem_t *pxSemaphore )
+{
+	SYS_STATS_DEC(sem.used);
+	vPortFree( *pxSemaphore );
+}
+
+#endif /* LWIP_SYS_ARCH_NOTIFY */
+
+#endif /* !NO_SYS */
@@ -399,6 +399,7 @@ extern "C" {
 #define	XQSPIPS_FLASH_OPCODE_FAST_READ	0x0B /* Fast read data bytes */
 #define	XQSPIPS_FLASH_OPCODE_BE_4K	0x20 /* Erase 4KiB block */
 #define	XQSPIPS_FLASH_OPCODE_RDSR2	0x35 /* Read status register 2 */
+#define	XQSPIPS_FLASH_OPCODE_QPP	0x32 /* Quad page program */
 #define	XQSPIPS_FLASH_OPCODE_DUAL_READ	0x3B /* Dual read data bytes */
 #define	XQSPIPS_FLASH_OPCODE_BE_32K	0x52 /* Erase 32KiB block */
 #define	XQSPIPS_FLASH_OPCODE_QUAD_READ	0x6B /* Quad read data bytes */
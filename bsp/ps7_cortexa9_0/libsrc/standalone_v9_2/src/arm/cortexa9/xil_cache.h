@@ -85,6 +85,21 @@ extern "C" {
 *@endcond
 */
 
+/**
+* Lengths from which Xil_DCacheFlushRange() flushes the whole L1 data cache
+* by set/way, or the whole L2 cache by way, instead of walking the range one
+* line at a time. Flushing more than was asked for is always safe, and past
+* these sizes it is also quicker. Xil_DCacheInvalidateRange() always works
+* line by line, since a whole-cache operation would have to write back
+* unrelated dirty data or throw it away.
+*/
+#ifndef XIL_DCACHE_L1_FLUSH_ALL_LEN
+#define XIL_DCACHE_L1_FLUSH_ALL_LEN		(32U * 1024U)
+#endif
+#ifndef XIL_DCACHE_L2_FLUSH_ALL_LEN
+#define XIL_DCACHE_L2_FLUSH_ALL_LEN		(256U * 1024U)
+#endif
+
 void Xil_DCacheEnable(void);
 void Xil_DCacheDisable(void);
 void Xil_DCacheInvalidate(void);
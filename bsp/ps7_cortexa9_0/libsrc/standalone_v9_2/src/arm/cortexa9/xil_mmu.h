@@ -69,6 +69,16 @@ extern "C" {
 /* Execution type */
 #define EXECUTE_NEVER ((0x1 << 4) | (0x1 << 0))
 
+/* Second-level (small page) mappings for Xil_SetTlbAttributesRange */
+#define XIL_MMU_PAGE_SIZE		0x1000U
+#define XIL_MMU_SECTION_SIZE	0x100000U
+
+/* Number of 1KB second-level tables reserved for splitting sections. Each
+ * one lets a single 1MB section be mapped at 4KB granularity. */
+#ifndef XIL_MMU_L2_TABLES
+#define XIL_MMU_L2_TABLES		8U
+#endif
+
 /**
 *@endcond
 */
@@ -81,6 +91,7 @@ void Xil_SetTlbAttributes(INTPTR Addr, u32 attrib);
 void Xil_EnableMMU(void);
 void Xil_DisableMMU(void);
 void* Xil_MemMap(UINTPTR PhysAddr, size_t size, u32 flags);
+s32 Xil_SetTlbAttributesRange(INTPTR Addr, size_t Size, u32 attrib);
 
 #ifdef __cplusplus
 }
@@ -93,6 +93,7 @@ extern "C" {
 #define XPS_L2CC_ADDR_FILTER_END_OFFSET		0x0C04U		/* Start of address filtering */
 
 #define XPS_L2CC_DEBUG_CTRL_OFFSET		0x0F40U		/* Debug Control Register */
+#define XPS_L2CC_PREFETCH_CTRL_OFFSET		0x0F60U		/* Prefetch Control Register */
 
 /* XPS_L2CC_CNTRL_OFFSET bit masks */
 #define XPS_L2CC_ENABLE_MASK		0x00000001U	/* enables the L2CC */
@@ -121,6 +122,16 @@ extern "C" {
                                                     /* Event monitor bus enable and Way Size (64 KB) */
 #define XPS_L2CC_AUX_REG_ZERO_MASK	0xFFF1FFFFU	/* */
 
+/* XPS_L2CC_PREFETCH_CTRL_OFFSET bit masks. The two prefetch enables are the
+ * same bits as in the auxiliary control register. */
+#define XPS_L2CC_PREFETCH_DLE_MASK	0x40000000U	/* Double linefill enable */
+#define XPS_L2CC_PREFETCH_IPFE_MASK	0x20000000U	/* Instruction prefetch enable */
+#define XPS_L2CC_PREFETCH_DPFE_MASK	0x10000000U	/* Data prefetch enable */
+#define XPS_L2CC_PREFETCH_DLWRAPD_MASK	0x08000000U	/* Double linefill on WRAP read disable */
+#define XPS_L2CC_PREFETCH_DROP_MASK	0x01000000U	/* Prefetch drop enable */
+#define XPS_L2CC_PREFETCH_INCRDLE_MASK	0x00800000U	/* Incr double linefill enable */
+#define XPS_L2CC_PREFETCH_OFFSET_MASK	0x0000001FU	/* Prefetch offset */
+
 #define XPS_L2CC_TAG_RAM_DEFAULT_MASK	0x00000111U	/* latency for TAG RAM */
 #define XPS_L2CC_DATA_RAM_DEFAULT_MASK	0x00000121U	/* latency for DATA RAM */
 
@@ -11,6 +11,11 @@
 *
 * Contains required functions for the ARM cache functionality.
 *
+* Range operations issue their L2 line operations back to back and wait for
+* the L2 controller with a single cache sync at the end. Large flushes switch
+* to whole-cache operations (see XIL_DCACHE_L1_FLUSH_ALL_LEN and
+* XIL_DCACHE_L2_FLUSH_ALL_LEN in xil_cache.h).
+*
 * <pre>
 * MODIFICATION HISTORY:
 *
@@ -373,9 +378,10 @@ void Xil_DCacheInvalidateRange(INTPTR adr, u32 len)
 		while (tempadr < endaddr) {
 			/* Invalidate L2 cache line */
 			*L2CCOffset = tempadr;
-			Xil_L2CacheSync();
 			((MAX_ADDR - (u32)tempadr) < cacheline) ? (tempadr = MAX_ADDR) : (tempadr += cacheline) ;
 		}
+		/* PA line operations are atomic on the PL310, one sync at the end suffices */
+		Xil_L2CacheSync();
 #endif
 
 		while (adr < endaddr) {
@@ -481,32 +487,42 @@ void Xil_DCacheFlushRange(INTPTR adr, u32 len)
 		((MAX_ADDR - (u32)adr) < len) ? (opendadr = MAX_ADDR) : (opendadr = adr + len);
 		adr &= ~(cacheline - 1U);
 
-		tempadr = adr;
+		if (len >= XIL_DCACHE_L1_FLUSH_ALL_LEN) {
+			/* Cheaper to flush every set/way than to walk the range */
+			Xil_L1DCacheFlush();
+		} else {
+			tempadr = adr;
 
-		while (tempadr < opendadr) {
-			/* Flush L1 Data cache line */
+			while (tempadr < opendadr) {
+				/* Flush L1 Data cache line */
 #if defined (__GNUC__) || defined (__ICCARM__)
-			asm_cp15_clean_inval_dc_line_mva_poc(tempadr);
+				asm_cp15_clean_inval_dc_line_mva_poc(tempadr);
 #else
-			{ volatile register u32 Reg
-				__asm(XREG_CP15_CLEAN_INVAL_DC_LINE_MVA_POC);
-			  Reg = tempadr; }
+				{ volatile register u32 Reg
+					__asm(XREG_CP15_CLEAN_INVAL_DC_LINE_MVA_POC);
+				  Reg = tempadr; }
 #endif
-			((MAX_ADDR - (u32)tempadr) < cacheline) ? (tempadr = MAX_ADDR) : (tempadr += cacheline);
+				((MAX_ADDR - (u32)tempadr) < cacheline) ? (tempadr = MAX_ADDR) : (tempadr += cacheline);
+			}
+			/* Wait for L1 cache clean and invalidation to complete */
+			dsb();
 		}
-		/* Wait for L1 cache clean and invalidation to complete */
-		dsb();
 
 #ifndef USE_AMP
-		/* Disable Write-back and line fills */
-		Xil_L2WriteDebugCtrl(0x3U);
-		while ((u32)adr < opendadr) {
-			/* Flush L2 cache line */
-			*L2CCOffset = adr;
+		if (len >= XIL_DCACHE_L2_FLUSH_ALL_LEN) {
+			/* Background clean and invalidate of all ways */
+			Xil_L2CacheFlush();
+		} else {
+			/* Disable Write-back and line fills */
+			Xil_L2WriteDebugCtrl(0x3U);
+			while ((u32)adr < opendadr) {
+				/* Flush L2 cache line */
+				*L2CCOffset = adr;
+				((MAX_ADDR - (u32)adr) < cacheline) ? (adr = MAX_ADDR) : (adr += cacheline);
+			}
 			Xil_L2CacheSync();
-			((MAX_ADDR - (u32)adr) < cacheline) ? (adr = MAX_ADDR) : (adr += cacheline);
+			Xil_L2WriteDebugCtrl(0x0U);
 		}
-		Xil_L2WriteDebugCtrl(0x0U);
 #endif
 	}
 	mtcpsr(currmask);
@@ -1406,9 +1422,9 @@ void Xil_L2CacheInvalidateRange(u32 adr, u32 len)
 
 		while (LocalAddr < end) {
 			*L2CCOffset = LocalAddr;
-			Xil_L2CacheSync();
 			((MAX_ADDR - LocalAddr) < cacheline) ? (LocalAddr = MAX_ADDR) : (LocalAddr += cacheline);
 		}
+		Xil_L2CacheSync();
 
 		/* Enable Write-back and line fills */
 		Xil_L2WriteDebugCtrl(0x0U);
@@ -1517,9 +1533,9 @@ void Xil_L2CacheFlushRange(u32 adr, u32 len)
 
 		while (LocalAddr < end) {
 			*L2CCOffset = LocalAddr;
-			Xil_L2CacheSync();
 			((MAX_ADDR - LocalAddr) < cacheline) ? (LocalAddr = MAX_ADDR) : (LocalAddr += cacheline);
 		}
+		Xil_L2CacheSync();
 
 		/* Enable Write-back and line fills */
 		Xil_L2WriteDebugCtrl(0x0U);
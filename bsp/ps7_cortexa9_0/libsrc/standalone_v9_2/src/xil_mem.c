@@ -49,6 +49,13 @@ void Xil_MemCpy(void* dst, const void* src, u32 cnt)
 	char *d = (char*)(void *)dst;
 	const char *s = src;
 
+#ifdef XIL_MEM_NEON
+	if (cnt >= (u32)XIL_MEM_NEON_MIN) {
+		(void)Xil_MemCpyNeon(dst, src, cnt);
+		return;
+	}
+#endif
+
 	while (cnt >= sizeof (s32)) {
 		*(s32*)d = *(s32*)s;
 		d += sizeof (s32);
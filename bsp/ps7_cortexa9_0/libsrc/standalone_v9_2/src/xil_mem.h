@@ -34,10 +34,30 @@
 extern "C" {
 #endif
 
+/************************** Constant Definitions *****************************/
+
+#if defined (__GNUC__) && defined (__ARM_ARCH_7A__)
+/* Cortex-A9: NEON versions in xil_mem_neon.S */
+#define XIL_MEM_NEON
+/* Copies shorter than this go to the C library, the NEON setup doesn't pay
+ * for itself below a few cache lines */
+#define XIL_MEM_NEON_MIN	128
+#endif
+
+#ifndef __ASSEMBLER__
+
 /************************** Function Prototypes *****************************/
 
 void Xil_MemCpy(void* dst, const void* src, u32 cnt);
 
+#ifdef XIL_MEM_NEON
+void *Xil_MemCpyNeon(void *dst, const void *src, u32 cnt);
+void *Xil_MemMoveNeon(void *dst, const void *src, u32 cnt);
+void *Xil_MemSetNeon(void *dst, s32 c, u32 cnt);
+#endif
+
+#endif /* __ASSEMBLER__ */
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,7 +9,9 @@
 * @file xil_mmu.c
 *
 * This file provides APIs for enabling/disabling MMU and setting the memory
-* attributes for sections, in the MMU translation table.
+* attributes for sections, in the MMU translation table. Attributes can also
+* be set on 4KB pages, in which case the 1MB section holding them is split
+* into a second-level table taken from a small static pool.
 *
 * <pre>
 * MODIFICATION HISTORY:
@@ -48,6 +50,7 @@
 #include "xil_types.h"
 #include "xil_mmu.h"
 #include "xil_errata.h"
+#include "xstatus.h"
 
 /***************** Macros (Inline Functions) Definitions *********************/
 
@@ -60,12 +63,30 @@
 #define	ARM_AR_MEM_TTB_SECT_SIZE_MASK	(~(ARM_AR_MEM_TTB_SECT_SIZE-1UL))
 /**< Mask off lower bits of addr */
 
+#define XIL_MMU_PAGE_MASK		(~(XIL_MMU_PAGE_SIZE - 1U))
+#define XIL_MMU_L2_ENTRIES		256U	/**< 4KB pages per 1MB section */
+
+/* First-level descriptor types (bits [1:0]) */
+#define XIL_MMU_L1_TYPE_MASK	0x3U
+#define XIL_MMU_L1_FAULT		0x0U
+#define XIL_MMU_L1_PAGE_TABLE	0x1U
+#define XIL_MMU_L1_TABLE_MASK	0xFFFFFC00U
+#define XIL_MMU_DOMAIN_MASK		0x1E0U
+
 /************************** Variable Definitions *****************************/
 
 extern u32 MMUTable;
 
+/* Second-level tables, 256 small page descriptors each. They have to be 1KB
+ * aligned to be pointed at from a first-level descriptor. */
+static u32 MmuL2Tables[XIL_MMU_L2_TABLES][XIL_MMU_L2_ENTRIES]
+	__attribute__ ((aligned (1024)));
+static u8 MmuL2TableUsed[XIL_MMU_L2_TABLES];
+
 /************************** Function Prototypes ******************************/
 
+static void Xil_MmuReleaseL2Table(u32 Descriptor);
+
 /*****************************************************************************/
 /**
 * @brief	This function sets the memory attributes for a section covering 1MB
@@ -92,6 +113,7 @@ void Xil_SetTlbAttributes(INTPTR Addr, u32 attrib)
 	ptr = &MMUTable;
 	ptr += section;
 	if(ptr != NULL) {
+		Xil_MmuReleaseL2Table(*ptr);
 		*ptr = (Addr & 0xFFF00000U) | attrib;
 	}
 
@@ -206,3 +228,209 @@ void* Xil_MemMap(UINTPTR PhysAddr, size_t size, u32 flags)
    }
    return (void*)PhysAddr;
 }
+
+/*****************************************************************************/
+/**
+* @brief	Convert section attributes, as used by Xil_SetTlbAttributes and
+*			defined in xil_mmu.h, to the equivalent small page attributes.
+*
+* @param	attrib  Section attributes.
+*
+* @return	Small page descriptor bits, without the address.
+*
+******************************************************************************/
+static u32 Xil_MmuSectionToPageAttrib(u32 attrib)
+{
+	u32 Page;
+
+	if ((attrib & XIL_MMU_L1_TYPE_MASK) == XIL_MMU_L1_FAULT) {
+		return 0U;
+	}
+
+	Page = 0x2U;					/* small page */
+	Page |= attrib & 0xCU;			/* C, B */
+	Page |= (attrib >> 4) & 0x1U;		/* XN */
+	Page |= (attrib >> 6) & 0x30U;		/* AP[1:0] */
+	Page |= (attrib >> 6) & 0x1C0U;	/* TEX[2:0] */
+	Page |= (attrib >> 6) & 0x200U;	/* AP[2] */
+	Page |= (attrib >> 6) & 0xC00U;	/* S, nG */
+
+	return Page;
+}
+
+/*****************************************************************************/
+/**
+* @brief	Return a second-level table to the pool if the given first-level
+*			descriptor points at one.
+*
+* @param	Descriptor  First-level descriptor that is being replaced.
+*
+* @return	None.
+*
+******************************************************************************/
+static void Xil_MmuReleaseL2Table(u32 Descriptor)
+{
+	u32 Index;
+
+	if ((Descriptor & XIL_MMU_L1_TYPE_MASK) != XIL_MMU_L1_PAGE_TABLE) {
+		return;
+	}
+
+	Index = ((Descriptor & XIL_MMU_L1_TABLE_MASK) - (u32)(UINTPTR)MmuL2Tables) /
+			sizeof(MmuL2Tables[0]);
+	if (Index < XIL_MMU_L2_TABLES) {
+		MmuL2TableUsed[Index] = 0U;
+	}
+}
+
+/*****************************************************************************/
+/**
+* @brief	Get the second-level table for a 1MB section, splitting the
+*			section into 256 pages with its current attributes if it is not
+*			already split.
+*
+* @param	Section  Index of the section in the first-level table.
+* @param	attrib  Attributes the caller is about to apply, used for the
+*			domain if the section is currently unmapped.
+*
+* @return	Pointer to the second-level table, or NULL if the pool is empty.
+*
+******************************************************************************/
+static u32 *Xil_MmuGetL2Table(u32 Section, u32 attrib)
+{
+	u32 *L1Entry = &MMUTable + Section;
+	u32 Descriptor = *L1Entry;
+	u32 SectionBase = Section * XIL_MMU_SECTION_SIZE;
+	u32 PageAttrib;
+	u32 Domain;
+	u32 *Table = NULL;
+	u32 Index;
+
+	if ((Descriptor & XIL_MMU_L1_TYPE_MASK) == XIL_MMU_L1_PAGE_TABLE) {
+		return (u32 *)(UINTPTR)(Descriptor & XIL_MMU_L1_TABLE_MASK);
+	}
+
+	for (Index = 0U; Index < XIL_MMU_L2_TABLES; Index++) {
+		if (MmuL2TableUsed[Index] == 0U) {
+			MmuL2TableUsed[Index] = 1U;
+			Table = MmuL2Tables[Index];
+			break;
+		}
+	}
+	if (Table == NULL) {
+		return NULL;
+	}
+
+	PageAttrib = Xil_MmuSectionToPageAttrib(Descriptor);
+	for (Index = 0U; Index < XIL_MMU_L2_ENTRIES; Index++) {
+		Table[Index] = (PageAttrib != 0U) ?
+				((SectionBase + (Index * XIL_MMU_PAGE_SIZE)) | PageAttrib) : 0U;
+	}
+
+	if ((Descriptor & XIL_MMU_L1_TYPE_MASK) == XIL_MMU_L1_FAULT) {
+		Domain = attrib & XIL_MMU_DOMAIN_MASK;
+	} else {
+		Domain = Descriptor & XIL_MMU_DOMAIN_MASK;
+	}
+
+	/* The table walk doesn't look in the L1 data cache, so the new table
+	 * has to reach memory before anything points at it */
+	Xil_DCacheFlushRange((INTPTR)Table, sizeof(MmuL2Tables[0]));
+	dsb();
+
+	*L1Entry = ((u32)(UINTPTR)Table & XIL_MMU_L1_TABLE_MASK) | Domain |
+			XIL_MMU_L1_PAGE_TABLE;
+
+	return Table;
+}
+
+/*****************************************************************************/
+/**
+* @brief	This function sets the memory attributes for an arbitrary range
+*			of memory, at 4KB granularity.
+*
+* @param	Addr  Start of the range. Rounded down to a 4KB boundary.
+* @param	Size  Size of the range in bytes. The end is rounded up to a 4KB
+*			boundary.
+* @param	attrib  Attribute for the given memory region, in the same section
+*			format as Xil_SetTlbAttributes (see xil_mmu.h). RESERVED unmaps
+*			the pages, so they can be used as guard pages.
+*
+* @return	XST_SUCCESS, XST_INVALID_PARAM if the range wraps past the end of
+*			the address space, or XST_FAILURE if there were not enough
+*			second-level tables (see XIL_MMU_L2_TABLES). On failure the
+*			sections before the one that could not be split have already
+*			been changed.
+*
+* @note		Whole 1MB sections inside the range are written as sections, and
+*			any second-level table they used is returned to the pool. Only
+*			the partial sections at either end use second-level tables. As
+*			with Xil_SetTlbAttributes, the MMU or D-cache does not need to be
+*			disabled, and callers must not change the table concurrently.
+*
+******************************************************************************/
+s32 Xil_SetTlbAttributesRange(INTPTR Addr, size_t Size, u32 attrib)
+{
+	u32 *L1Entry;
+	u32 *Table;
+	u32 PageAttrib = Xil_MmuSectionToPageAttrib(attrib);
+	UINTPTR Page;
+	UINTPTR LastPage;
+	UINTPTR SectionLastPage;
+	s32 Status = XST_SUCCESS;
+
+	if (Size == 0U) {
+		return XST_SUCCESS;
+	}
+	if (((UINTPTR)Addr + Size - 1U) < (UINTPTR)Addr) {
+		return XST_INVALID_PARAM;
+	}
+
+	Page = (UINTPTR)Addr & XIL_MMU_PAGE_MASK;
+	LastPage = ((UINTPTR)Addr + Size - 1U) & XIL_MMU_PAGE_MASK;
+
+	for (;;) {
+		SectionLastPage = (Page | (XIL_MMU_SECTION_SIZE - 1U)) & XIL_MMU_PAGE_MASK;
+		if (SectionLastPage > LastPage) {
+			SectionLastPage = LastPage;
+		}
+
+		L1Entry = &MMUTable + (Page / XIL_MMU_SECTION_SIZE);
+
+		if (((Page & (XIL_MMU_SECTION_SIZE - 1U)) == 0U) &&
+				((SectionLastPage + XIL_MMU_PAGE_SIZE) % XIL_MMU_SECTION_SIZE) == 0U) {
+			Xil_MmuReleaseL2Table(*L1Entry);
+			*L1Entry = (Page & ARM_AR_MEM_TTB_SECT_SIZE_MASK) | attrib;
+		} else {
+			Table = Xil_MmuGetL2Table(Page / XIL_MMU_SECTION_SIZE, attrib);
+			if (Table == NULL) {
+				Status = XST_FAILURE;
+				break;
+			}
+			for (;;) {
+				Table[(Page / XIL_MMU_PAGE_SIZE) % XIL_MMU_L2_ENTRIES] =
+						(PageAttrib != 0U) ? (Page | PageAttrib) : 0U;
+				if (Page == SectionLastPage) {
+					break;
+				}
+				Page += XIL_MMU_PAGE_SIZE;
+			}
+		}
+
+		if (SectionLastPage == LastPage) {
+			break;
+		}
+		Page = SectionLastPage + XIL_MMU_PAGE_SIZE;
+	}
+
+	Xil_DCacheFlush();
+
+	mtcp(XREG_CP15_INVAL_UTLB_UNLOCKED, 0U);
+	/* Invalidate all branch predictors */
+	mtcp(XREG_CP15_INVAL_BRANCH_ARRAY, 0U);
+
+	dsb(); /* ensure completion of the BP and TLB invalidation */
+	isb(); /* synchronize context on this processor */
+
+	return Status;
+}
@@ -0,0 +1,106 @@
+#include "crc32.h"
+
+/*
+ * Slicing-by-8: eight tables let the loop fold in eight bytes with two word
+ * loads and eight independent lookups, instead of one lookup per byte. The
+ * Cortex-A9 has no CRC or 64-bit carry-less multiply instructions to do
+ * better with. The tables (8KB) are built at run time rather than stored in
+ * the image.
+ */
+static u32 crcTable[8][256];
+
+#define CRC32_POLY 0xEDB88320
+
+/* x^(2^n) modulo the polynomial, for crc32Combine() */
+static u32 x2nTable[32];
+
+/* a * b modulo the polynomial, in the reflected bit order the CRC uses */
+static u32 multModP(u32 a, u32 b)
+{
+	u32 m = (u32)1 << 31;
+	u32 p = 0;
+
+	for (;;) {
+		if (a & m) {
+			p ^= b;
+			if ((a & (m - 1)) == 0) {
+				break;
+			}
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ CRC32_POLY : b >> 1;
+	}
+	return p;
+}
+
+/* x^(n * 2^k) modulo the polynomial */
+static u32 x2nModP(u32 n, u32 k)
+{
+	u32 p = (u32)1 << 31;
+
+	while (n) {
+		if (n & 1) {
+			p = multModP(x2nTable[k & 31], p);
+		}
+		n >>= 1;
+		k++;
+	}
+	return p;
+}
+
+void crc32Init(void)
+{
+	for (u32 n = 0; n < 256; n++) {
+		u32 c = n;
+
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		}
+		crcTable[0][n] = c;
+	}
+
+	for (u32 n = 0; n < 256; n++) {
+		for (int k = 1; k < 8; k++) {
+			crcTable[k][n] = crcTable[0][crcTable[k - 1][n] & 0xFF] ^ (crcTable[k - 1][n] >> 8);
+		}
+	}
+
+	x2nTable[0] = (u32)1 << 30;
+	for (int n = 1; n < 32; n++) {
+		x2nTable[n] = multModP(x2nTable[n - 1], x2nTable[n - 1]);
+	}
+}
+
+u32 crc32Update(u32 crc, const u8 *data, u32 size)
+{
+	crc = ~crc;
+
+	while (size && ((UINTPTR)data & 3)) {
+		crc = crcTable[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+		size--;
+	}
+
+	while (size >= 8) {
+		u32 one = *(const u32 *)data ^ crc;
+		u32 two = *(const u32 *)(data + 4);
+
+		crc = crcTable[7][one & 0xFF] ^ crcTable[6][(one >> 8) & 0xFF] ^
+			crcTable[5][(one >> 16) & 0xFF] ^ crcTable[4][one >> 24] ^
+			crcTable[3][two & 0xFF] ^ crcTable[2][(two >> 8) & 0xFF] ^
+			crcTable[1][(two >> 16) & 0xFF] ^ crcTable[0][two >> 24];
+		data += 8;
+		size -= 8;
+	}
+
+	while (size--) {
+		crc = crcTable[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+u32 crc32Combine(u32 crcA, u32 crcB, u32 sizeB)
+{
+	/* Appending sizeB bytes multiplies A's remainder by x^(8 * sizeB) */
+	return multModP(x2nModP(sizeB, 3), crcA) ^ crcB;
+}
@@ -0,0 +1,23 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <xil_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CRC-32 as in zlib, Ethernet and PNG. Start with crc = 0, and feed the
+ * result back in to continue over more data. */
+void crc32Init(void);
+u32 crc32Update(u32 crc, const u8 *data, u32 size);
+
+/* The CRC of A followed by B, from the CRCs of each and B's size. Lets
+ * pieces be checksummed out of order and joined up afterwards. */
+u32 crc32Combine(u32 crcA, u32 crcB, u32 sizeB);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC32_H */
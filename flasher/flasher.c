@@ -1,9 +1,16 @@
 #include <xqspips.h>
+#include <xscugic.h>
+#include <xil_exception.h>
+#include <xil_mem.h>
+#include <xil_printf.h>
+#include <xtime_l.h>
 
+#include "crc32.h"
 #include "flasher.h"
 
 #define W25Q_PAGE_SIZE 256
 #define W25Q_SECTOR_SIZE 65536 // 64KB
+#define W25Q_SUBSECTOR_SIZE 4096 // 4KB, the smallest erase
 
 #define QSPI_DEVICE_ID XPAR_XQSPIPS_0_DEVICE_ID
 #define QSPI_CONNECTION_MODE (XPAR_XQSPIPS_0_QSPI_MODE)
@@ -24,10 +31,16 @@
 #define LQSPI_CR_1_DUMMY_BYTE		0x00000100 /* 1 Dummy Byte between
 						     address and return data */
 
+#define QSPI_LINEAR_BASE	XPAR_PS7_QSPI_LINEAR_0_S_AXI_BASEADDR
+
 static XQspiPs QspiInstance;
 static u32 QspiFlashSize;
 static u32 QspiFlashMake;
 
+/* Commands picked by flasherInit(), quad if the flash and the board allow */
+static u8 programCmd = XQSPIPS_FLASH_OPCODE_PP;
+static u8 readCmd = XQSPIPS_FLASH_OPCODE_FAST_READ;
+
 /*
  * The following constants specify the max amount of data and the size of the
  * the buffer required to hold the data and overhead to transfer the data to
@@ -38,16 +51,59 @@ static u32 QspiFlashMake;
 				     reads */
 #define DUMMY_SIZE			1 /* Number of dummy bytes for fast, dual and
 				     quad reads */
+/* Verify reads this much per command, the setup cost is 5 bytes each */
+#define VERIFY_CHUNK_SIZE	4096
+
 /*
  * The following variables are used to read and write to the eeprom and they
- * are global to avoid having large buffers on the stack
+ * are global to avoid having large buffers on the stack. A read sends as
+ * many bytes as it receives, so both are sized for the largest read.
  */
-u8 readBuffer[W25Q_PAGE_SIZE + DATA_OFFSET + DUMMY_SIZE];
-u8 writeBuffer[W25Q_PAGE_SIZE + DATA_OFFSET + DUMMY_SIZE];
+u8 readBuffer[VERIFY_CHUNK_SIZE + FLASH_READ_OVERHEAD];
+u8 writeBuffer[VERIFY_CHUNK_SIZE + FLASH_READ_OVERHEAD];
+
+/* Sector reads land here, alternating, so one can be on the wire while the
+ * other is compared. readCommand is what gets sent during a read. */
+static u8 sectorBuffer[2][W25Q_SUBSECTOR_SIZE + FLASH_READ_OVERHEAD];
+static u8 readCommand[W25Q_SUBSECTOR_SIZE + FLASH_READ_OVERHEAD];
+
+/* Page program commands, one being sent while the next is filled */
+static u8 pageBuffer[2][W25Q_PAGE_SIZE + DATA_OFFSET];
+
+/* What each 4KB sector of the image needs, and which of its 16 pages */
+#define SECTOR_SAME		0
+#define SECTOR_PROGRAM	1
+#define SECTOR_ERASE	2
+
+static u8 sectorPlan[FLASH_SIZE_16MB / W25Q_SUBSECTOR_SIZE];
+static u16 pageMask[FLASH_SIZE_16MB / W25Q_SUBSECTOR_SIZE];
+// CRC32 of each sector as last read from the flash
+static u32 sectorCrc[FLASH_SIZE_16MB / W25Q_SUBSECTOR_SIZE];
+
+/* Progress and timing lines. Streaming turns them off, as it programs and
+ * verifies the image a chunk at a time. */
+static int verbose = 1;
+
+// Whether [flashAddr, flashAddr + byteCount) lies within the flash, without
+// letting the sum wrap
+static int inFlash(u32 flashAddr, u32 byteCount)
+{
+	return byteCount <= FLASH_SIZE_16MB && flashAddr <= FLASH_SIZE_16MB - byteCount;
+}
+
+static XScuGic IntcInstance;
+static volatile int transferDone;
+static volatile u32 transferEvent;
 
 #define READ_ID_CMD			0x9F
 #define RD_ID_SIZE			4 /* Read ID command + 3 bytes ID response */
 
+/* Quad Enable bit: in status register 2 (Winbond) or the configuration
+ * register (Spansion), both read with 0x35 and written as the second byte of
+ * 0x01, or in status register 1 (Macronix, ISSI). Micron parts need none. */
+#define QE_SR2_MASK			0x02
+#define QE_SR1_MASK			0x40
+
 #define MICRON_ID		0x20
 #define SPANSION_ID		0x01
 #define WINBOND_ID		0xEF
@@ -92,6 +148,81 @@ static void flashWaitForBusy(void) {
     }
 }
 
+static u8 flashReadStatus(u8 cmd)
+{
+	writeBuffer[0] = cmd;
+	writeBuffer[1] = 0x00;
+	XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, readBuffer, 2);
+	return readBuffer[1];
+}
+
+static s32 flashWriteStatus(u8 sr1, u8 sr2, u32 count)
+{
+	s32 status;
+
+	writeBuffer[0] = XQSPIPS_FLASH_OPCODE_WREN;
+	status = XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, 1);
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	writeBuffer[0] = XQSPIPS_FLASH_OPCODE_WRSR;
+	writeBuffer[1] = sr1;
+	writeBuffer[2] = sr2;
+	status = XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, count);
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	flashWaitForBusy();
+	return XST_SUCCESS;
+}
+
+// Set the flash's Quad Enable bit if it has one. The bit is non-volatile, so
+// it's only written when it isn't set already.
+static s32 flashEnableQuad(void)
+{
+	u8 sr1, sr2;
+
+	if (QSPI_CONNECTION_MODE != SINGLE_FLASH_CONNECTION ||
+			QSPI_BUS_WIDTH != QSPI_BUSWIDTH_FOUR) {
+		return XST_FAILURE;
+	}
+
+	switch (QspiFlashMake) {
+	case MICRON_ID:
+		return XST_SUCCESS;
+
+	case WINBOND_ID:
+	case SPANSION_ID:
+		sr2 = flashReadStatus(XQSPIPS_FLASH_OPCODE_RDSR2);
+		if (sr2 & QE_SR2_MASK) {
+			return XST_SUCCESS;
+		}
+		sr1 = flashReadStatus(XQSPIPS_FLASH_OPCODE_RDSR1);
+		if (flashWriteStatus(sr1, sr2 | QE_SR2_MASK, 3) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		sr2 = flashReadStatus(XQSPIPS_FLASH_OPCODE_RDSR2);
+		return (sr2 & QE_SR2_MASK) ? XST_SUCCESS : XST_FAILURE;
+
+	case MACRONIX_ID:
+	case ISSI_ID:
+		sr1 = flashReadStatus(XQSPIPS_FLASH_OPCODE_RDSR1);
+		if (sr1 & QE_SR1_MASK) {
+			return XST_SUCCESS;
+		}
+		if (flashWriteStatus(sr1 | QE_SR1_MASK, 0, 2) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		sr1 = flashReadStatus(XQSPIPS_FLASH_OPCODE_RDSR1);
+		return (sr1 & QE_SR1_MASK) ? XST_SUCCESS : XST_FAILURE;
+
+	default:
+		return XST_FAILURE;
+	}
+}
+
 static u32 FlashReadID(void)
 {
 	u32 Status;
@@ -170,6 +301,58 @@ static u32 FlashReadID(void)
 	return XST_SUCCESS;
 }
 
+// Start a transfer in interrupt mode. The CPU is free until qspiFinish().
+static s32 qspiStart(u8 *send, u8 *recv, u32 count)
+{
+	transferDone = 0;
+	return XQspiPs_Transfer(&QspiInstance, send, recv, count);
+}
+
+static s32 qspiFinish(void)
+{
+	while (!transferDone)
+		;
+	return (transferEvent == XST_SPI_TRANSFER_DONE) ? XST_SUCCESS : XST_FAILURE;
+}
+
+static void qspiStatusHandler(void *callBackRef, u32 statusEvent, unsigned byteCount)
+{
+	transferEvent = statusEvent;
+	transferDone = 1;
+}
+
+static s32 setupInterrupts(void)
+{
+	XScuGic_Config *intcConfig;
+	s32 status;
+
+	intcConfig = XScuGic_LookupConfig(XPAR_SCUGIC_SINGLE_DEVICE_ID);
+	if (NULL == intcConfig) {
+		return XST_FAILURE;
+	}
+
+	status = XScuGic_CfgInitialize(&IntcInstance, intcConfig, intcConfig->CpuBaseAddress);
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	Xil_ExceptionInit();
+	Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+			(Xil_ExceptionHandler)XScuGic_InterruptHandler, &IntcInstance);
+
+	status = XScuGic_Connect(&IntcInstance, XPAR_XQSPIPS_0_INTR,
+			(Xil_ExceptionHandler)XQspiPs_InterruptHandler, &QspiInstance);
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	XQspiPs_SetStatusHandler(&QspiInstance, &QspiInstance, qspiStatusHandler);
+	XScuGic_Enable(&IntcInstance, XPAR_XQSPIPS_0_INTR);
+	Xil_ExceptionEnable();
+
+	return XST_SUCCESS;
+}
+
 u32 flasherInit(void)
 {
 	XQspiPs_Config *QspiConfig;
@@ -197,146 +380,595 @@ u32 flasherInit(void)
 	// Assert the FLASH chip select.
 	XQspiPs_SetSlaveSelect(&QspiInstance);
 
+	crc32Init();
+
+	// Large transfers run in interrupt mode
+	Status = setupInterrupts();
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
 	// Read Flash ID and extract Manufacture and Size information
 	Status = FlashReadID();
 	if (Status != XST_SUCCESS) {
 		return XST_FAILURE;
 	}
 
+	// With all four data lines wired and the Quad Enable bit set, program
+	// with Quad Page Program and read with Quad Output Fast Read. The board
+	// routes the QSPI feedback clock (MIO 8), so the controller can sample
+	// with the loopback clock and run at 100 MHz, the fastest it supports.
+	// Otherwise stay single-lane at the old, conservative 25 MHz.
+	if (flashEnableQuad() == XST_SUCCESS) {
+		programCmd = XQSPIPS_FLASH_OPCODE_QPP;
+		readCmd = XQSPIPS_FLASH_OPCODE_QUAD_READ;
+
+		XQspiPs_WriteReg(QspiConfig->BaseAddress, XQSPIPS_LPBK_DLY_ADJ_OFFSET,
+				XQSPIPS_LPBK_DLY_ADJ_USE_LPBK_MASK);
+		XQspiPs_SetClkPrescaler(&QspiInstance, XQSPIPS_CLK_PRESCALE_2);
+
+		xil_printf("Quad I/O at %d MHz\r\n", XPAR_XQSPIPS_0_QSPI_CLK_FREQ_HZ / 2000000);
+	} else {
+		xil_printf("Single I/O at %d MHz\r\n", XPAR_XQSPIPS_0_QSPI_CLK_FREQ_HZ / 8000000);
+	}
+
 	return XST_SUCCESS;
 }
 
+void flasherSetVerbose(int on)
+{
+	verbose = on;
+}
+
 s32 flashRead(uint32_t address, uint8_t *rdPtr, uint32_t size)
 {
-    writeBuffer[0] = 0x03;
+    if (size > VERIFY_CHUNK_SIZE) {
+        return XST_FAILURE;
+    }
+
+    writeBuffer[0] = readCmd;
     writeBuffer[1] = (uint8_t)(address >> 16);
     writeBuffer[2] = (uint8_t)(address >> 8);
     writeBuffer[3] = (uint8_t)address;
 
-	// Need to read the total size + 4 (for the write command and 3 addr bytes)
-    return XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, rdPtr, size + 4);
+	// Fast and quad reads take a dummy byte after the address, the data
+	// follows it
+    return XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, rdPtr, size + FLASH_READ_OVERHEAD);
 }
 
-// Function to program a large buffer from DDR to Flash
-s32 flasherProgram(u32 flashAddr, u32 sourceAddr, u32 byteCount) {
-	s32 status = XST_SUCCESS;
-    u32 left = byteCount;
-    u32 currAddr = flashAddr;
-	u32 percent;
-	u32 pagesProcessed;
-	u32 totalSize;
-    u8 *currSource = (u8 *)sourceAddr;
-
-    xil_printf("Erasing needed sectors...\n\r");
-
-	// Erase
-    for (u32 i = 0; i < byteCount; i += W25Q_SECTOR_SIZE) {
-        // A Write Enable instruction must be executed before the device
-        // will accept the Block Erase Instruction
-		writeBuffer[0] = 0x06;
-        status = XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, 1);
-		if (status != XST_SUCCESS) {
-			return XST_FAILURE;
+static s32 flashWriteEnable(void)
+{
+	// A Write Enable instruction must be executed before the device will
+	// accept an erase or a program command
+	writeBuffer[0] = XQSPIPS_FLASH_OPCODE_WREN;
+	return XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, 1);
+}
+
+static s32 flashStartRead(u32 address, u8 *rdPtr, u32 size)
+{
+	readCommand[0] = readCmd;
+	readCommand[1] = (u8)(address >> 16);
+	readCommand[2] = (u8)(address >> 8);
+	readCommand[3] = (u8)address;
+
+	return qspiStart(readCommand, rdPtr, size + FLASH_READ_OVERHEAD);
+}
+
+static int flashIsBusy(void)
+{
+	return flashReadStatus(XQSPIPS_FLASH_OPCODE_RDSR1) & 0x01; // WIP bit
+}
+
+static s32 flashStartErase(u8 cmd, u32 address)
+{
+	s32 status;
+
+	status = flashWriteEnable();
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	writeBuffer[0] = cmd;
+	writeBuffer[1] = (u8)(address >> 16);
+	writeBuffer[2] = (u8)(address >> 8);
+	writeBuffer[3] = (u8)address;
+	return XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, 4);
+}
+
+static int isErased(const u8 *data, u32 size)
+{
+	for (u32 i = 0; i < size; i++) {
+		if (data[i] != 0xFF) {
+			return 0;
 		}
+	}
+	return 1;
+}
 
-        // Call the 64KB block erase function
-		writeBuffer[0] = 0xD8;
-        writeBuffer[1] = (u8)((currAddr + i) >> 16);
-        writeBuffer[2] = (u8)((currAddr + i) >> 8);
-        writeBuffer[3] = (u8)(currAddr + i);
-        status = XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, 4);
-		if (status != XST_SUCCESS) {
-			return XST_FAILURE;
+// Programming can only clear bits. A sector whose new contents don't set any
+// bit that's clear in flash can be programmed as it is, anything else needs
+// an erase first.
+static int needsErase(const u8 *flash, const u8 *source, u32 size)
+{
+	for (u32 i = 0; i < size; i++) {
+		if ((flash[i] & source[i]) != source[i]) {
+			return 1;
 		}
+	}
+	return 0;
+}
 
-        flashWaitForBusy();
+static void classifySector(u32 sector, const u8 *flash, const u8 *source, u32 size)
+{
+	u16 mask = 0;
+
+	if (memcmp(flash, source, size) == 0) {
+		sectorPlan[sector] = SECTOR_SAME;
+		sectorCrc[sector] = crc32Update(0, flash, size);
+	} else if (needsErase(flash, source, size)) {
+		// Pages that are blank in the image stay blank after the erase
+		for (u32 i = 0; i * W25Q_PAGE_SIZE < size; i++) {
+			u32 offset = i * W25Q_PAGE_SIZE;
+			u32 pageSize = (size - offset > W25Q_PAGE_SIZE) ? W25Q_PAGE_SIZE : size - offset;
+
+			if (!isErased(source + offset, pageSize)) {
+				mask |= 1 << i;
+			}
+		}
+		sectorPlan[sector] = SECTOR_ERASE;
+	} else {
+		for (u32 i = 0; i * W25Q_PAGE_SIZE < size; i++) {
+			u32 offset = i * W25Q_PAGE_SIZE;
+			u32 pageSize = (size - offset > W25Q_PAGE_SIZE) ? W25Q_PAGE_SIZE : size - offset;
+
+			if (memcmp(flash + offset, source + offset, pageSize) != 0) {
+				mask |= 1 << i;
+			}
+		}
+		sectorPlan[sector] = SECTOR_PROGRAM;
+	}
 
-		// Display progress
-		percent = (u32)(((u64)i * 100) / byteCount);
-		xil_printf("\rErase Progress: %3d%% [%08X]", percent, currAddr + i);
-    }
+	pageMask[sector] = mask;
+}
 
-	xil_printf("\n\r");
+/*
+ * Work done while the flash is busy erasing or programming: copying the next
+ * page into a command buffer, and comparing the read-back of the last sector
+ * written with the image.
+ */
+static struct {
+	int pending;
+	u8 *buffer;
+	u32 address;
+	const u8 *source;
+	u32 size;
+} pageJob;
+
+static struct {
+	int pending;
+	const u8 *flash;
+	u32 sector;
+	u32 address;
+	const u8 *source;
+	u32 size;
+} verifyJob;
+
+static s32 verifyStatus;
+
+static void preparePage(u8 *buffer, u32 address, const u8 *source, u32 size)
+{
+	pageJob.buffer = buffer;
+	pageJob.address = address;
+	pageJob.source = source;
+	pageJob.size = size;
+	pageJob.pending = 1;
+}
 
-	// Write
-	totalSize = left;
-	pagesProcessed = 0;
-    while (left > 0) {
-        u32 sendSize = (left > W25Q_PAGE_SIZE) ? W25Q_PAGE_SIZE : left;
+static void runPageJob(void)
+{
+	pageJob.buffer[0] = programCmd;
+	pageJob.buffer[1] = (u8)(pageJob.address >> 16);
+	pageJob.buffer[2] = (u8)(pageJob.address >> 8);
+	pageJob.buffer[3] = (u8)pageJob.address;
+	Xil_MemCpyNeon(&pageJob.buffer[4], pageJob.source, pageJob.size);
+	pageJob.pending = 0;
+}
 
-        // A Write Enable instruction must be executed before the device
-        // will accept the Page Program command
-        writeBuffer[0] = 0x06;
-        status = XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, 1);
-		if (status != XST_SUCCESS) {
-			return XST_FAILURE;
+static void runVerifyJob(void)
+{
+	if (memcmp(verifyJob.flash, verifyJob.source, verifyJob.size) != 0) {
+		// Report where it first failed within this sector
+		for (u32 i = 0; i < verifyJob.size; i++) {
+			if (verifyJob.flash[i] != verifyJob.source[i]) {
+				xil_printf("\r\nVerification Error at 0x%08X\n\r", verifyJob.address + i);
+				break;
+			}
+		}
+		verifyStatus = XST_FAILURE;
+	}
+	sectorCrc[verifyJob.sector] = crc32Update(0, verifyJob.flash, verifyJob.size);
+	verifyJob.pending = 0;
+}
+
+static void runJobs(void)
+{
+	if (pageJob.pending) {
+		runPageJob();
+	}
+	if (verifyJob.pending) {
+		runVerifyJob();
+	}
+}
+
+// A command that failed partway can leave a job behind. Drop it, so the next
+// command doesn't run it against buffers that have been reused since.
+static void clearJobs(void)
+{
+	pageJob.pending = 0;
+	verifyJob.pending = 0;
+}
+
+// Wait for an erase or program to finish, doing the pending jobs meanwhile.
+// The page is needed as soon as the flash is free, so it goes first.
+static void flashWaitBusyWorking(void)
+{
+	while (flashIsBusy()) {
+		if (pageJob.pending) {
+			runPageJob();
+		} else if (verifyJob.pending) {
+			runVerifyJob();
 		}
+	}
+}
+
+static s32 flashProgramPage(u8 *buffer, u32 size)
+{
+	s32 status;
+
+	status = flashWriteEnable();
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	status = qspiStart(buffer, NULL, size + 4);
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	return qspiFinish();
+}
+
+// Pass 1: read the flash back a sector at a time and decide what each sector
+// needs. The next read is on the wire while the last one is compared.
+static s32 planUpdate(u32 flashAddr, const u8 *source, u32 byteCount, u32 sectors)
+{
+	s32 status;
 
-        // Prepare Page Program Command
-        writeBuffer[0] = 0x02;
-        writeBuffer[1] = (u8)(currAddr >> 16);
-        writeBuffer[2] = (u8)(currAddr >> 8);
-        writeBuffer[3] = (u8)(currAddr);
-        memcpy(&writeBuffer[4], currSource, sendSize);
+	if (byteCount == 0) {
+		return XST_SUCCESS;
+	}
+
+	status = flashStartRead(flashAddr, sectorBuffer[0],
+			(byteCount > W25Q_SUBSECTOR_SIZE) ? W25Q_SUBSECTOR_SIZE : byteCount);
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
 
-        // Transfer data
-        status = XQspiPs_PolledTransfer(&QspiInstance, writeBuffer, NULL, sendSize + 4);
+	for (u32 s = 0; s < sectors; s++) {
+		u32 offset = s * W25Q_SUBSECTOR_SIZE;
+		u32 size = (byteCount - offset > W25Q_SUBSECTOR_SIZE) ? W25Q_SUBSECTOR_SIZE : byteCount - offset;
+
+		status = qspiFinish();
 		if (status != XST_SUCCESS) {
 			return XST_FAILURE;
 		}
 
-        flashWaitForBusy();
+		if (s + 1 < sectors) {
+			u32 next = offset + W25Q_SUBSECTOR_SIZE;
 
-        left -= sendSize;
-        currAddr += sendSize;
-        currSource += sendSize;
-		pagesProcessed++;
+			status = flashStartRead(flashAddr + next, sectorBuffer[(s + 1) & 1],
+					(byteCount - next > W25Q_SUBSECTOR_SIZE) ? W25Q_SUBSECTOR_SIZE : byteCount - next);
+			if (status != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+		}
 
-		// Display progress
-		if ((pagesProcessed % 64) == 0 || left == 0) {
-			percent = (u32)(((u64)(totalSize - left) * 100) / totalSize);
-			xil_printf("\rProgramming Progress: %3d%% [%08X]", percent, currAddr);
+		classifySector(s, &sectorBuffer[s & 1][FLASH_READ_OVERHEAD], source + offset, size);
+	}
+
+	return XST_SUCCESS;
+}
+
+// Function to program a large buffer from DDR to Flash.
+//
+// Only what changed is rewritten. Pass 1 reads the flash back and marks each
+// 4KB sector as unchanged, programmable in place (only bits to clear) or in
+// need of an erase, along with the pages to program. Pass 2 carries that out
+// with 4KB sector erases (or one block erase if the whole 64KB block
+// changed), and reads back every sector it touched to verify it. Unchanged
+// sectors were verified by pass 1.
+//
+// Each sector's CRC32 is taken from the bytes read back from the flash, by
+// pass 1 for unchanged sectors and by the read-back for rewritten ones. If
+// crc is given, those are joined up in address order and added to *crc, so
+// the caller gets the CRC32 of the flash without reading it a second time.
+//
+// Pass 2 keeps the CPU busy while the flash is: the next page is copied into
+// its command buffer and the previous sector's read-back is compared while an
+// erase or a program is in progress.
+s32 flasherProgram(u32 flashAddr, u32 sourceAddr, u32 byteCount, u32 *crc) {
+	s32 status = XST_SUCCESS;
+	const u8 *source = (const u8 *)sourceAddr;
+	u32 sectors = (byteCount + W25Q_SUBSECTOR_SIZE - 1) / W25Q_SUBSECTOR_SIZE;
+	u32 blockEraseEnd = 0;
+	u32 readBack = 0;
+	u32 percent;
+	XTime start, end;
+	u32 sectorsUnchanged = 0;
+	u32 sectorsErased = 0;
+	u32 pagesProgrammed = 0;
+
+	if ((flashAddr % W25Q_SUBSECTOR_SIZE) != 0) {
+		xil_printf("ERROR: Flash address 0x%08X is not sector aligned\n\r", flashAddr);
+		return XST_FAILURE;
+	}
+	if (!inFlash(flashAddr, byteCount)) {
+		xil_printf("ERROR: 0x%08X bytes at 0x%08X run past the end of flash\n\r", byteCount, flashAddr);
+		return XST_FAILURE;
+	}
+
+	clearJobs();
+
+	XTime_GetTime(&start);
+	status = planUpdate(flashAddr, source, byteCount, sectors);
+	if (status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	XTime_GetTime(&end);
+	if (verbose) {
+		xil_printf("Compared in %d ms\n\r", (u32)((end - start) * 1000 / COUNTS_PER_SECOND));
+	}
+
+	XTime_GetTime(&start);
+	verifyStatus = XST_SUCCESS;
+
+	for (u32 s = 0; s < sectors; s++) {
+		u32 offset = s * W25Q_SUBSECTOR_SIZE;
+		u32 size = (byteCount - offset > W25Q_SUBSECTOR_SIZE) ? W25Q_SUBSECTOR_SIZE : byteCount - offset;
+		u32 perBlock = W25Q_SECTOR_SIZE / W25Q_SUBSECTOR_SIZE;
+		u16 mask = pageMask[s];
+		int page = 0;
+		int buf = 0;
+
+		if (sectorPlan[s] == SECTOR_SAME) {
+			sectorsUnchanged++;
+			continue;
 		}
-    }
 
-	xil_printf("\n\r");
+		// The first page is copied while the erase runs
+		while (mask && !(mask & (1 << page))) {
+			page++;
+		}
+		if (mask) {
+			preparePage(pageBuffer[buf], flashAddr + offset + page * W25Q_PAGE_SIZE,
+					source + offset + page * W25Q_PAGE_SIZE,
+					(size - page * W25Q_PAGE_SIZE > W25Q_PAGE_SIZE) ? W25Q_PAGE_SIZE : size - page * W25Q_PAGE_SIZE);
+		}
+
+		if (sectorPlan[s] == SECTOR_ERASE) {
+			if (((flashAddr + offset) % W25Q_SECTOR_SIZE) == 0 && s + perBlock <= sectors) {
+				u32 i;
+
+				for (i = s; i < s + perBlock && sectorPlan[i] == SECTOR_ERASE; i++)
+					;
+				if (i == s + perBlock) {
+					status = flashStartErase(XQSPIPS_FLASH_OPCODE_SE, flashAddr + offset);
+					if (status != XST_SUCCESS) {
+						return XST_FAILURE;
+					}
+					blockEraseEnd = s + perBlock;
+					flashWaitBusyWorking();
+				}
+			}
+			if (s >= blockEraseEnd) {
+				status = flashStartErase(XQSPIPS_FLASH_OPCODE_BE_4K, flashAddr + offset);
+				if (status != XST_SUCCESS) {
+					return XST_FAILURE;
+				}
+				flashWaitBusyWorking();
+			}
+			sectorsErased++;
+		}
+
+		while (mask) {
+			u32 pageOffset = page * W25Q_PAGE_SIZE;
+			u32 pageSize = (size - pageOffset > W25Q_PAGE_SIZE) ? W25Q_PAGE_SIZE : size - pageOffset;
+
+			if (pageJob.pending) {
+				runPageJob();
+			}
+			status = flashProgramPage(pageBuffer[buf], pageSize);
+			if (status != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+			pagesProgrammed++;
+
+			// Queue up the next page in the other buffer while this one
+			// is programmed
+			mask &= ~(1 << page);
+			buf ^= 1;
+			while (mask && !(mask & (1 << page))) {
+				page++;
+			}
+			if (mask) {
+				preparePage(pageBuffer[buf], flashAddr + offset + page * W25Q_PAGE_SIZE,
+						source + offset + page * W25Q_PAGE_SIZE,
+						(size - page * W25Q_PAGE_SIZE > W25Q_PAGE_SIZE) ? W25Q_PAGE_SIZE : size - page * W25Q_PAGE_SIZE);
+			}
 
-	left = byteCount;
-	currAddr = flashAddr;
-	currSource = (u8 *)sourceAddr;
-	pagesProcessed = 0;
-	while (left > 0) {
-		// Verify pages if possible
-        u32 readSize = (left > W25Q_PAGE_SIZE) ? W25Q_PAGE_SIZE : left;
+			flashWaitBusyWorking();
+		}
 
-		status = flashRead(currAddr, readBuffer, readSize);
+		// Read the sector back. It's compared during the next erase or
+		// program, or at the end.
+		if (verifyJob.pending) {
+			runVerifyJob();
+		}
+		status = flashStartRead(flashAddr + offset, sectorBuffer[readBack], size);
+		if (status != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		status = qspiFinish();
 		if (status != XST_SUCCESS) {
 			return XST_FAILURE;
 		}
+		verifyJob.flash = &sectorBuffer[readBack][FLASH_READ_OVERHEAD];
+		verifyJob.sector = s;
+		verifyJob.address = flashAddr + offset;
+		verifyJob.source = source + offset;
+		verifyJob.size = size;
+		verifyJob.pending = 1;
+		readBack ^= 1;
+
+		// Display progress
+		if (verbose && ((s % perBlock) == perBlock - 1 || s == sectors - 1)) {
+			percent = (u32)(((u64)(s + 1) * 100) / sectors);
+			xil_printf("\rUpdate Progress: %3d%% [%08X]", percent, flashAddr + offset + size);
+		}
+	}
+
+	runJobs();
+
+	XTime_GetTime(&end);
+	if (verbose) {
+		xil_printf("\n\rUpdated in %d ms: %d of %d sectors unchanged, %d erased, %d pages programmed\n\r",
+				(u32)((end - start) * 1000 / COUNTS_PER_SECOND), sectorsUnchanged, sectors,
+				sectorsErased, pagesProgrammed);
+	}
+
+	if (verifyStatus == XST_SUCCESS && crc != NULL) {
+		for (u32 s = 0; s < sectors; s++) {
+			u32 offset = s * W25Q_SUBSECTOR_SIZE;
+			u32 size = (byteCount - offset > W25Q_SUBSECTOR_SIZE) ? W25Q_SUBSECTOR_SIZE : byteCount - offset;
+
+			*crc = crc32Combine(*crc, sectorCrc[s], size);
+		}
+	}
+
+	return verifyStatus;
+}
+
+// Read through the linear window: the controller turns plain loads from
+// QSPI_LINEAR_BASE into read commands, so NEON block copies pull the flash in
+// with wide AXI reads and no command overhead per chunk. Each 4KB is
+// compared with compare and copied to copy, where those are given, and added
+// to *crc. *crc is continued from its value on entry, so a range scanned in
+// pieces adds up to the CRC32 of the whole.
+static s32 linearScan(const char *what, u32 flashAddr, u32 byteCount,
+		const u8 *compare, u8 *copy, u32 *crc)
+{
+	s32 status = XST_SUCCESS;
+	u32 percent;
+	XTime start, end;
+
+	if (!inFlash(flashAddr, byteCount)) {
+		return XST_FAILURE;
+	}
+
+	XTime_GetTime(&start);
+
+	// Linear mode picks the chip select itself
+	XQspiPs_SetOptions(&QspiInstance, XQSPIPS_LQSPI_MODE_OPTION | XQSPIPS_HOLD_B_DRIVE_OPTION);
+	XQspiPs_SetLqspiConfigReg(&QspiInstance, XQSPIPS_LQSPI_CR_LINEAR_MASK |
+			LQSPI_CR_1_DUMMY_BYTE | readCmd);
+	XQspiPs_Enable(&QspiInstance);
+
+	for (u32 offset = 0; offset < byteCount; offset += W25Q_SUBSECTOR_SIZE) {
+		u32 size = (byteCount - offset > W25Q_SUBSECTOR_SIZE) ? W25Q_SUBSECTOR_SIZE : byteCount - offset;
+		u8 *chunk = copy ? copy + offset : sectorBuffer[0];
 
-		if (memcmp(&readBuffer[4], currSource, readSize) != 0) {
-			// Find where it failed within this chunk
-			for (u32 i = 0; i < readSize; i++) {
-				if (readBuffer[i + 4] != currSource[i]) {
-					xil_printf("\r\nVerification Error at 0x%08X\n\r", currAddr + i);
+		Xil_MemCpyNeon(chunk, (const void *)(QSPI_LINEAR_BASE + flashAddr + offset), size);
+
+		if (compare && memcmp(chunk, compare + offset, size) != 0) {
+			for (u32 i = 0; i < size; i++) {
+				if (chunk[i] != compare[offset + i]) {
+					xil_printf("\r\nVerification Error at 0x%08X\n\r", flashAddr + offset + i);
 					status = XST_FAILURE;
+					break;
 				}
 			}
 		}
 
-		left -= readSize;
-		currAddr += readSize;
-		currSource += readSize;
-		pagesProcessed++;
+		*crc = crc32Update(*crc, chunk, size);
 
 		// Display progress
-		if ((pagesProcessed % 64) == 0 || left == 0) {
-			percent = (u32)(((u64)(totalSize - left) * 100) / totalSize);
-			xil_printf("\rVerification Progress: %3d%% [%08X]", percent, currAddr);
+		if (verbose && (((offset / W25Q_SUBSECTOR_SIZE) % 64) == 63 || offset + size == byteCount)) {
+			percent = (u32)(((u64)(offset + size) * 100) / byteCount);
+			xil_printf("\r%s Progress: %3d%% [%08X]", what, percent, flashAddr + offset + size);
 		}
 	}
 
-	xil_printf("\n\r");
+	// Back to I/O mode
+	XQspiPs_Disable(&QspiInstance);
+	XQspiPs_SetOptions(&QspiInstance, XQSPIPS_FORCE_SSELECT_OPTION | XQSPIPS_HOLD_B_DRIVE_OPTION);
+	XQspiPs_SetSlaveSelect(&QspiInstance);
+
+	XTime_GetTime(&end);
+	if (verbose) {
+		xil_printf("\n\r%s done in %d ms, CRC32 0x%08X over %d bytes\n\r", what,
+				(u32)((end - start) * 1000 / COUNTS_PER_SECOND), *crc, byteCount);
+	}
 
 	return status;
-}
\ No newline at end of file
+}
+
+// Compare the flash with the image and return its CRC32, which the host can
+// check against the file it sent without reading the flash back over JTAG.
+s32 flasherVerify(u32 flashAddr, u32 sourceAddr, u32 byteCount, u32 *crc)
+{
+	return linearScan("Verification", flashAddr, byteCount, (const u8 *)sourceAddr, NULL, crc);
+}
+
+// Copy the flash to destAddr, for the host to dump
+s32 flasherReadBack(u32 flashAddr, u32 destAddr, u32 byteCount, u32 *crc)
+{
+	return linearScan("Read Back", flashAddr, byteCount, NULL, (u8 *)destAddr, crc);
+}
+
+s32 flasherCrc(u32 flashAddr, u32 byteCount, u32 *crc)
+{
+	return linearScan("CRC", flashAddr, byteCount, NULL, NULL, crc);
+}
+
+// Erase every 4KB sector the range touches, with 64KB block erases where a
+// whole block is covered.
+s32 flasherErase(u32 flashAddr, u32 byteCount)
+{
+	u32 end = flashAddr + byteCount;
+	s32 status;
+
+	if ((flashAddr % W25Q_SUBSECTOR_SIZE) != 0) {
+		xil_printf("ERROR: Flash address 0x%08X is not sector aligned\n\r", flashAddr);
+		return XST_FAILURE;
+	}
+	if (!inFlash(flashAddr, byteCount)) {
+		return XST_FAILURE;
+	}
+
+	clearJobs();
+
+	while (flashAddr < end) {
+		if ((flashAddr % W25Q_SECTOR_SIZE) == 0 && end - flashAddr >= W25Q_SECTOR_SIZE) {
+			status = flashStartErase(XQSPIPS_FLASH_OPCODE_SE, flashAddr);
+			flashAddr += W25Q_SECTOR_SIZE;
+		} else {
+			status = flashStartErase(XQSPIPS_FLASH_OPCODE_BE_4K, flashAddr);
+			flashAddr += W25Q_SUBSECTOR_SIZE;
+		}
+		if (status != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		flashWaitBusyWorking();
+	}
+
+	return XST_SUCCESS;
+}
@@ -1,18 +1,101 @@
 #ifndef FLASHER_H
 #define FLASHER_H
 
+/*
+ * Mailbox between the flasher and the host, at the start of CONFIG_ZONE.
+ *
+ * The flasher sets STATUS to STATUS_READY once it is up. To run a command
+ * the host fills in FLASH_OFFSET and IMAGE_SIZE, then writes COMMAND. The
+ * flasher sets STATUS to STATUS_BUSY and only then clears COMMAND, so once
+ * the host reads COMMAND as 0, STATUS is either BUSY or the result. While
+ * busy, BYTES_DONE and ELAPSED_* are updated after every 64KB. At the end
+ * STATUS is STATUS_DONE, or STATUS_FAILED with the reason in ERROR, and
+ * CRC32 holds the CRC32 of the flash range. The flasher then waits for the
+ * next command, so operations can be chained without reloading it.
+ */
 typedef struct {
-    uint32_t START;
-    uint32_t IMAGE_SIZE;
+    uint32_t COMMAND;     // CMD_*, cleared by the flasher when taken
+    uint32_t IMAGE_SIZE;  // Bytes to operate on, compressed ones for the LZ4 commands
+    uint32_t CRC32;       // CRC32 of the flash range after a command
+    uint32_t WRITE_INDEX; // Streaming: image bytes the host has put in the ring
+    uint32_t READ_INDEX;  // Streaming: image bytes programmed and verified
+    uint32_t FLASH_OFFSET; // Where in flash, 4KB aligned
+    uint32_t STATUS;      // STATUS_*
+    uint32_t ERROR;       // ERROR_* when STATUS_FAILED
+    uint32_t BYTES_DONE;  // Progress of the current command
+    uint32_t ELAPSED_LO;  // Global timer counts since the command was taken,
+    uint32_t ELAPSED_HI;  // at COUNTS_PER_SECOND (325 MHz)
+    uint32_t SLOT;        // Boot slot written by the last command, or SLOT_NONE
+    uint32_t SEQUENCE;    // Sequence number of the record committed for it
     // Add other config registers here
 } ConfigMemory;
 
+/* Values of COMMAND. The staging zone is at _STAGING_START. */
+#define CMD_PROGRAM        0x01 // Program the image staged in full, verify it
+#define CMD_PROGRAM_STREAM 0x02 // Program the image as it arrives through the ring
+#define CMD_ERASE          0x03 // Erase the range, rounded out to 4KB sectors
+#define CMD_VERIFY         0x04 // Compare the range with the staged image
+#define CMD_READ_BACK      0x05 // Copy the range into the staging zone
+#define CMD_CRC            0x06 // Only compute the CRC32 of the range
+#define CMD_PROGRAM_LZ4    0x07 // CMD_PROGRAM with an LZ4 frame staged (see lz4.h)
+#define CMD_PROGRAM_LZ4_STREAM 0x08 // CMD_PROGRAM_STREAM with an LZ4 frame streamed
+
+/* FLASH_OFFSET for the program commands: write the inactive boot slot and
+ * commit its version record (see slots.h) */
+#define FLASH_OFFSET_SLOT  0xFFFFFFFF
+#define SLOT_NONE          0xFFFFFFFF
+
+/* Values of STATUS */
+#define STATUS_BOOTING     0x00 // The host clears STATUS before starting the flasher
+#define STATUS_READY       0x01
+#define STATUS_BUSY        0x02
+#define STATUS_DONE        0x03
+#define STATUS_FAILED      0x04
+
+/* Values of ERROR */
+#define ERROR_NONE         0x00
+#define ERROR_INIT         0x01 // The QSPI controller or flash didn't come up
+#define ERROR_BAD_COMMAND  0x02
+#define ERROR_BAD_RANGE    0x03 // Empty, unaligned, past the end of flash or too big for a slot
+#define ERROR_ERASE        0x04
+#define ERROR_PROGRAM      0x05 // Programming failed, or its read-back didn't match
+#define ERROR_VERIFY       0x06 // The flash differs from the staged image
+#define ERROR_BAD_IMAGE    0x07 // Malformed LZ4 frame, no content size, or its checksum failed
+
+/*
+ * Streaming: the first STREAM_RING_SIZE bytes of the staging zone are a ring
+ * of STREAM_CHUNK_SIZE chunks. The host sets WRITE_INDEX to 0 before sending
+ * CMD_PROGRAM_STREAM. It then writes image bytes at
+ * WRITE_INDEX % STREAM_RING_SIZE, a chunk at a time, and advances
+ * WRITE_INDEX, keeping it within STREAM_RING_SIZE of READ_INDEX. The flasher
+ * programs and verifies each chunk as soon as it is complete and then
+ * advances READ_INDEX, so the next chunks can cross JTAG meanwhile.
+ *
+ * The LZ4 commands take an LZ4 frame with the content size in its header in
+ * place of the image, IMAGE_SIZE being the size of the frame. Only the
+ * compressed bytes go through the staging zone or the ring. The flasher
+ * decompresses it 64KB at a time and programs and verifies each 64KB as it
+ * comes out. READ_INDEX and BYTES_DONE count frame bytes; CRC32 is still
+ * that of the flash range, i.e. of the decompressed image.
+ */
+#define STREAM_CHUNK_SIZE 0x00010000 // 64KB, one flash block
+#define STREAM_RING_SIZE  0x00100000 // 1MB
+
 #define CONFIG_REGISTER ((volatile ConfigMemory *)0x00200000)
 
-#define QSPI_ADDR        0x00000000 // QSPI flash offset
+/* flashRead() returns the command, address and dummy byte echo first */
+#define FLASH_READ_OVERHEAD	5
 
 u32 flasherInit(void);
-s32 flasherProgram(u32 flashAddr, u32 sourceAddr, u32 byteCount);
+/* Writes the range and reads every sector of it back. On success the CRC32
+ * of the bytes read back from the flash, not of the source, is added to *crc
+ * (crc may be NULL). The other commands take *crc the same way. */
+s32 flasherProgram(u32 flashAddr, u32 sourceAddr, u32 byteCount, u32 *crc);
+s32 flasherVerify(u32 flashAddr, u32 sourceAddr, u32 byteCount, u32 *crc);
+s32 flasherReadBack(u32 flashAddr, u32 destAddr, u32 byteCount, u32 *crc);
+s32 flasherCrc(u32 flashAddr, u32 byteCount, u32 *crc);
+s32 flasherErase(u32 flashAddr, u32 byteCount);
+void flasherSetVerbose(int on);
 s32 flashRead(u32 address, u8 *rdPtr, u32 size);
 
 #endif /* FLASHER_H */
\ No newline at end of file
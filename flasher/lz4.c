@@ -0,0 +1,386 @@
+#include <xstatus.h>
+#include <xil_mem.h>
+
+#include "lz4.h"
+
+#define LZ4_MAGIC 0x184D2204
+
+/* Frame descriptor, FLG byte */
+#define LZ4_FLG_VERSION_MASK		0xC0
+#define LZ4_FLG_VERSION				0x40
+#define LZ4_FLG_BLOCK_CHECKSUM		0x10
+#define LZ4_FLG_CONTENT_SIZE		0x08
+#define LZ4_FLG_CONTENT_CHECKSUM	0x04
+#define LZ4_FLG_RESERVED			0x02
+#define LZ4_FLG_DICT_ID				0x01
+
+/* Frame descriptor, BD byte: bits 6-4 give the largest block, 4 (64KB) to
+ * 7 (4MB) */
+#define LZ4_BD_RESERVED		0x8F
+#define LZ4_BLOCK_MAX_ID(bd)	(((bd) >> 4) & 0x07)
+
+#define LZ4_BLOCK_UNCOMPRESSED	0x80000000
+#define LZ4_MIN_MATCH			4
+
+#define XXH_PRIME1 2654435761U
+#define XXH_PRIME2 2246822519U
+#define XXH_PRIME3 3266489917U
+#define XXH_PRIME4 668265263U
+#define XXH_PRIME5 374761393U
+
+/*
+ * Output position p lives at window[p & WINDOW_MASK]. The half being
+ * filled is handed to flush() as soon as it is full, and is still intact
+ * while the other half fills, which is as far back as a match can reach.
+ */
+#define WINDOW_SIZE (2 * LZ4_CHUNK_SIZE)
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+
+static u8 window[WINDOW_SIZE];
+
+static u32 read32(const u8 *p)
+{
+	return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+static u32 rotl32(u32 x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+/* XXH32 with seed 0, fed in whole 16-byte stripes */
+static void xxh32Reset(u32 v[4])
+{
+	v[0] = XXH_PRIME1 + XXH_PRIME2;
+	v[1] = XXH_PRIME2;
+	v[2] = 0;
+	v[3] = 0 - XXH_PRIME1;
+}
+
+static void xxh32Stripes(u32 v[4], const u8 *data, u32 size)
+{
+	for (u32 done = 0; size - done >= 16; done += 16) {
+		for (int k = 0; k < 4; k++) {
+			v[k] = rotl32(v[k] + read32(data + done + 4 * k) * XXH_PRIME2, 13) * XXH_PRIME1;
+		}
+	}
+}
+
+/* tail holds the last totalSize % 16 bytes, the ones left out of the stripes */
+static u32 xxh32Digest(const u32 v[4], u32 totalSize, const u8 *tail, u32 tailSize)
+{
+	u32 h;
+
+	if (totalSize >= 16) {
+		h = rotl32(v[0], 1) + rotl32(v[1], 7) + rotl32(v[2], 12) + rotl32(v[3], 18);
+	} else {
+		h = XXH_PRIME5;
+	}
+	h += totalSize;
+
+	for (; tailSize >= 4; tail += 4, tailSize -= 4) {
+		h = rotl32(h + read32(tail) * XXH_PRIME3, 17) * XXH_PRIME4;
+	}
+	for (; tailSize > 0; tail++, tailSize--) {
+		h = rotl32(h + *tail * XXH_PRIME5, 11) * XXH_PRIME1;
+	}
+
+	h ^= h >> 15;
+	h *= XXH_PRIME2;
+	h ^= h >> 13;
+	h *= XXH_PRIME3;
+	h ^= h >> 16;
+	return h;
+}
+
+/* Makes sure there's a byte at stream->in, fails at the end of the input */
+static s32 haveInput(Lz4Stream *stream)
+{
+	if (stream->in == stream->inEnd) {
+		u32 size = stream->fill(stream->ctx, &stream->in);
+
+		if (size == 0) {
+			return XST_FAILURE;
+		}
+		stream->inEnd = stream->in + size;
+	}
+	return XST_SUCCESS;
+}
+
+/* One byte out of the *left that remain in the current block */
+static s32 readByte(Lz4Stream *stream, u32 *left, u8 *byte)
+{
+	if (*left == 0 || haveInput(stream) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	(*left)--;
+	*byte = *stream->in++;
+	return XST_SUCCESS;
+}
+
+/* Frame bytes outside the blocks */
+static s32 readBytes(Lz4Stream *stream, u8 *data, u32 size)
+{
+	u32 left = size;
+
+	for (u32 i = 0; i < size; i++) {
+		if (readByte(stream, &left, &data[i]) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+	}
+	return XST_SUCCESS;
+}
+
+static s32 readWord(Lz4Stream *stream, u32 *word)
+{
+	u8 data[4];
+
+	if (readBytes(stream, data, sizeof(data)) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	*word = read32(data);
+	return XST_SUCCESS;
+}
+
+/* Adds the length bytes that follow a 15 in the token, up to the first that
+ * isn't 255 */
+static s32 readLength(Lz4Stream *stream, u32 *left, u32 *length)
+{
+	u8 byte;
+
+	do {
+		if (readByte(stream, left, &byte) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		*length += byte;
+	} while (byte == 255);
+
+	return XST_SUCCESS;
+}
+
+/* Output can't run past the size the header promised */
+static int fits(const Lz4Stream *stream, u32 count)
+{
+	return !(stream->flags & LZ4_FLG_CONTENT_SIZE) ||
+			(u64)stream->outPos + count <= stream->contentSize;
+}
+
+/* Hands over the chunk of size bytes that ends at outPos */
+static s32 flushChunk(Lz4Stream *stream, u32 size)
+{
+	const u8 *chunk = &window[(stream->outPos - size) & WINDOW_MASK];
+
+	xxh32Stripes(stream->hash, chunk, size);
+	return stream->flush(stream->ctx, chunk, size);
+}
+
+/* How much of count fits before the next chunk boundary */
+static u32 chunkRoom(const Lz4Stream *stream, u32 count)
+{
+	u32 room = LZ4_CHUNK_SIZE - stream->outPos % LZ4_CHUNK_SIZE;
+
+	return count < room ? count : room;
+}
+
+/* Moves outPos on, handing over the chunk once it is full */
+static s32 advance(Lz4Stream *stream, u32 count)
+{
+	stream->outPos += count;
+	if (stream->outPos % LZ4_CHUNK_SIZE == 0) {
+		return flushChunk(stream, LZ4_CHUNK_SIZE);
+	}
+	return XST_SUCCESS;
+}
+
+static s32 copyLiterals(Lz4Stream *stream, u32 count, u32 *left)
+{
+	if (count > *left || !fits(stream, count)) {
+		return XST_FAILURE;
+	}
+	*left -= count;
+
+	while (count > 0) {
+		u32 size;
+
+		if (haveInput(stream) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		size = chunkRoom(stream, count);
+		if (size > (u32)(stream->inEnd - stream->in)) {
+			size = stream->inEnd - stream->in;
+		}
+
+		Xil_MemCpyNeon(&window[stream->outPos & WINDOW_MASK], stream->in, size);
+		stream->in += size;
+		count -= size;
+		if (advance(stream, size) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+	}
+	return XST_SUCCESS;
+}
+
+static s32 copyMatch(Lz4Stream *stream, u32 offset, u32 count)
+{
+	if (offset == 0 || offset > stream->outPos || !fits(stream, count)) {
+		return XST_FAILURE;
+	}
+
+	while (count > 0) {
+		u32 size = chunkRoom(stream, count);
+		u32 from = (stream->outPos - offset) & WINDOW_MASK;
+		u8 *to = &window[stream->outPos & WINDOW_MASK];
+
+		if (offset >= size && from + size <= WINDOW_SIZE) {
+			Xil_MemCpyNeon(to, &window[from], size);
+		} else {
+			/* Overlaps its own output (a repeated pattern), or wraps
+			 * round the window: one byte at a time */
+			for (u32 i = 0; i < size; i++) {
+				to[i] = window[(from + i) & WINDOW_MASK];
+			}
+		}
+
+		count -= size;
+		if (advance(stream, size) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+	}
+	return XST_SUCCESS;
+}
+
+/* A compressed block: sequences of literals followed by a match, except for
+ * the last one, which ends the block after its literals */
+static s32 decodeBlock(Lz4Stream *stream, u32 left)
+{
+	while (left > 0) {
+		u8 token, low, high;
+		u32 literals, match;
+
+		if (readByte(stream, &left, &token) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		literals = token >> 4;
+		if (literals == 15 && readLength(stream, &left, &literals) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		if (copyLiterals(stream, literals, &left) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		if (left == 0) {
+			break;
+		}
+
+		if (readByte(stream, &left, &low) != XST_SUCCESS ||
+				readByte(stream, &left, &high) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		match = token & 0x0F;
+		if (match == 15 && readLength(stream, &left, &match) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		if (copyMatch(stream, (u32)low | (u32)high << 8, match + LZ4_MIN_MATCH) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+	}
+	return XST_SUCCESS;
+}
+
+s32 lz4ReadHeader(Lz4Stream *stream)
+{
+	u8 descriptor[2 + 8]; // FLG, BD and the content size
+	u32 size = 2;
+	u32 magic;
+	u32 v[4];
+	u8 check;
+
+	stream->in = NULL;
+	stream->inEnd = NULL;
+	stream->contentSize = 0;
+	stream->outPos = 0;
+	xxh32Reset(stream->hash);
+
+	if (readWord(stream, &magic) != XST_SUCCESS || magic != LZ4_MAGIC ||
+			readBytes(stream, descriptor, 2) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	stream->flags = descriptor[0];
+	if ((stream->flags & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION ||
+			(stream->flags & (LZ4_FLG_RESERVED | LZ4_FLG_DICT_ID)) != 0 ||
+			(descriptor[1] & LZ4_BD_RESERVED) != 0 || LZ4_BLOCK_MAX_ID(descriptor[1]) < 4) {
+		return XST_FAILURE;
+	}
+	stream->blockMax = 1U << (8 + 2 * LZ4_BLOCK_MAX_ID(descriptor[1]));
+
+	if (stream->flags & LZ4_FLG_CONTENT_SIZE) {
+		if (readBytes(stream, &descriptor[2], 8) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		stream->contentSize = read32(&descriptor[2]) | (u64)read32(&descriptor[6]) << 32;
+		size += 8;
+	}
+
+	/* The header checksum is the second byte of the descriptor's XXH32 */
+	if (readBytes(stream, &check, 1) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	xxh32Reset(v);
+	if (((xxh32Digest(v, size, descriptor, size) >> 8) & 0xFF) != check) {
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+s32 lz4Decode(Lz4Stream *stream)
+{
+	u32 blockSize, left, last, checksum;
+	const u8 *chunk;
+	s32 status;
+
+	for (;;) {
+		if (readWord(stream, &blockSize) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+		if (blockSize == 0) {
+			break; // EndMark
+		}
+
+		left = blockSize & ~LZ4_BLOCK_UNCOMPRESSED;
+		if (left > stream->blockMax) {
+			return XST_FAILURE;
+		}
+		if (blockSize & LZ4_BLOCK_UNCOMPRESSED) {
+			status = copyLiterals(stream, left, &left);
+		} else {
+			status = decodeBlock(stream, left);
+		}
+		if (status != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		if ((stream->flags & LZ4_FLG_BLOCK_CHECKSUM) && readWord(stream, &checksum) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+	}
+
+	last = stream->outPos % LZ4_CHUNK_SIZE;
+	chunk = &window[(stream->outPos - last) & WINDOW_MASK];
+	if (last != 0 && flushChunk(stream, last) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	if ((stream->flags & LZ4_FLG_CONTENT_SIZE) && stream->outPos != stream->contentSize) {
+		return XST_FAILURE;
+	}
+	if (stream->flags & LZ4_FLG_CONTENT_CHECKSUM) {
+		if (readWord(stream, &checksum) != XST_SUCCESS ||
+				xxh32Digest(stream->hash, stream->outPos, chunk + (last & ~15U), last & 15) != checksum) {
+			return XST_FAILURE;
+		}
+	}
+
+	return XST_SUCCESS;
+}
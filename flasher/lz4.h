@@ -0,0 +1,47 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <xil_types.h>
+
+/*
+ * Streaming decoder for LZ4 frames, as written by tools/lz4pack or
+ * `lz4 --content-size`. The compressed bytes are pulled through fill() in
+ * whatever runs the caller has them, and the output is pushed to flush() a
+ * LZ4_CHUNK_SIZE chunk at a time, so neither side ever has to hold the whole
+ * image. Matches reach at most 64KB back, so the decoder only keeps the
+ * chunk being filled and the one before it.
+ *
+ * Frames with a dictionary ID are refused. Block checksums are skipped, the
+ * content checksum (XXH32) is checked once the last chunk has been flushed.
+ */
+#define LZ4_CHUNK_SIZE 0x10000 // 64KB, one flash block
+
+typedef struct {
+	/* Points data at the next run of frame bytes and returns its length,
+	 * 0 once there are none left. The run stays valid until the next call. */
+	u32 (*fill)(void *ctx, const u8 **data);
+	/* Takes each LZ4_CHUNK_SIZE of output, only the last may be shorter */
+	s32 (*flush)(void *ctx, const u8 *data, u32 size);
+	void *ctx;
+
+	u64 contentSize; // From the frame header, 0 if it has none
+
+	/* Decoder state, set up by lz4ReadHeader() */
+	const u8 *in;
+	const u8 *inEnd;
+	u32 flags;
+	u32 blockMax;
+	u32 outPos;
+	u32 hash[4];
+} Lz4Stream;
+
+/* Reads the frame header and fills in contentSize. fill, flush and ctx must
+ * be set first. */
+s32 lz4ReadHeader(Lz4Stream *stream);
+
+/* Decodes the rest of the frame. Fails on a malformed or truncated frame,
+ * when the output doesn't match contentSize or the content checksum, or as
+ * soon as flush() does. */
+s32 lz4Decode(Lz4Stream *stream);
+
+#endif /* LZ4_H */
@@ -1,73 +1,428 @@
+#include <string.h>
 #include <xil_cache.h>
 #include <xil_mmu.h>
 #include <xqspips.h>
 #include <xil_printf.h>
+#include <xtime_l.h>
 
+#include "crc32.h"
 #include "flasher.h"
+#include "lz4.h"
+#include "slots.h"
 
 extern uint32_t _STAGING_START;
 extern uint32_t _STAGING_END;
 
-int32_t copy_flash(uint32_t dstAddr, uint32_t srcAddr, uint32_t imageSize)
+#define FLASH_SIZE       0x1000000 // 16MB
+#define SECTOR_SIZE      0x1000    // 4KB, the smallest erase
+
+static XTime commandStart;
+
+// When writing a boot slot, the image's first sector is held back here and
+// only programmed once the rest is in place, see programImage()
+#define NO_HOLD 0xFFFFFFFF
+static uint32_t holdAddr = NO_HOLD;
+static uint8_t heldSector[SLOT_HEADER_SIZE];
+static uint32_t heldSize;
+
+// State of an LZ4 program command, passed to the decoder's callbacks
+typedef struct {
+    uint32_t command;
+    uint32_t input;      // Staging zone, or the ring when streaming
+    uint32_t inputSize;  // Frame bytes, IMAGE_SIZE
+    uint32_t taken;      // Frame bytes handed to the decoder so far
+    uint32_t flashAddr;
+    uint32_t offset;     // Image bytes programmed so far
+    uint32_t crc;
+    uint32_t error;      // Why flush() failed
+    Lz4Stream stream;
+} Lz4Job;
+
+static const char *commandName(uint32_t command)
 {
-    int32_t status;
+    switch (command) {
+    case CMD_PROGRAM:        return "Program";
+    case CMD_PROGRAM_STREAM: return "Program (streamed)";
+    case CMD_ERASE:          return "Erase";
+    case CMD_VERIFY:         return "Verify";
+    case CMD_READ_BACK:      return "Read back";
+    case CMD_CRC:            return "CRC";
+    case CMD_PROGRAM_LZ4:    return "Program (LZ4)";
+    case CMD_PROGRAM_LZ4_STREAM: return "Program (LZ4, streamed)";
+    default:                 return NULL;
+    }
+}
 
-    // 16MB max image size
-    if (imageSize == 0 || imageSize > 0x1000000) {
-        xil_printf("ERROR: Invalid binary size. Aborting.\n\r");
-        return XST_FAILURE;
+static int isProgram(uint32_t command)
+{
+    return command == CMD_PROGRAM || command == CMD_PROGRAM_STREAM ||
+            command == CMD_PROGRAM_LZ4 || command == CMD_PROGRAM_LZ4_STREAM;
+}
+
+static int isLz4(uint32_t command)
+{
+    return command == CMD_PROGRAM_LZ4 || command == CMD_PROGRAM_LZ4_STREAM;
+}
+
+static uint32_t elapsedMs(void)
+{
+    XTime now;
+
+    XTime_GetTime(&now);
+    return (uint32_t)((now - commandStart) * 1000 / COUNTS_PER_SECOND);
+}
+
+static void reportProgress(uint32_t bytesDone)
+{
+    XTime now;
+
+    XTime_GetTime(&now);
+    now -= commandStart;
+    CONFIG_REGISTER->ELAPSED_HI = (uint32_t)(now >> 32);
+    CONFIG_REGISTER->ELAPSED_LO = (uint32_t)now;
+    CONFIG_REGISTER->BYTES_DONE = bytesDone;
+}
+
+// bytesDone of size, while the flash has been written up to flashAddr
+static void showProgress(uint32_t command, uint32_t bytesDone, uint32_t size, uint32_t flashAddr)
+{
+    uint32_t percent = (uint32_t)(((uint64_t)bytesDone * 100) / size);
+
+    reportProgress(bytesDone);
+    xil_printf("\r%s Progress: %3d%% [%08X]", commandName(command), percent, flashAddr);
+}
+
+static void readSlotRecords(SlotRecord records[SLOT_COUNT])
+{
+    static uint8_t buffer[sizeof(SlotRecord) + FLASH_READ_OVERHEAD];
+
+    for (int slot = 0; slot < SLOT_COUNT; slot++) {
+        if (flashRead(SLOT_RECORD(slot), buffer, sizeof(SlotRecord)) == XST_SUCCESS) {
+            memcpy(&records[slot], &buffer[FLASH_READ_OVERHEAD], sizeof(SlotRecord));
+        } else {
+            memset(&records[slot], 0, sizeof(SlotRecord));
+        }
     }
+}
 
-    // Make sure the source address is within the staging zone
-    if (srcAddr < (uint32_t)&_STAGING_START || srcAddr > (uint32_t)&_STAGING_END) {
-        xil_printf("ERROR: Invalid source address, outside of DDR region.\n\r");
+// Programs part of the image. The part for holdAddr, the start of a boot
+// slot, is kept in heldSector instead and the rest programmed after it.
+static s32 programImage(uint32_t flashAddr, uint32_t sourceAddr, uint32_t size, uint32_t *crc)
+{
+    if (flashAddr == holdAddr) {
+        heldSize = (size > SLOT_HEADER_SIZE) ? SLOT_HEADER_SIZE : size;
+        memcpy(heldSector, (const void *)sourceAddr, heldSize);
+        flashAddr += heldSize;
+        sourceAddr += heldSize;
+        size -= heldSize;
+    }
+
+    if (size == 0) {
+        return XST_SUCCESS;
+    }
+    return flasherProgram(flashAddr, sourceAddr, size, crc);
+}
+
+// Programs the held boot header last, now that the image behind it is
+// complete. *crc covers the rest of the image on entry and all of it after.
+static s32 programHeld(uint32_t imageSize, uint32_t *crc)
+{
+    uint32_t headerCrc = 0;
+
+    if (flasherProgram(holdAddr, (uint32_t)heldSector, heldSize, &headerCrc) != XST_SUCCESS) {
         return XST_FAILURE;
     }
 
-    xil_printf("Image size: %d\n\r", imageSize);
-    xil_printf("Starting Flash Write...\n\r");
+    *crc = crc32Combine(headerCrc, *crc, imageSize - heldSize);
+    return XST_SUCCESS;
+}
+
+// Hands the decoder the next run of the frame: up to 64KB of the staged
+// frame, or whatever the host has put in the ring since the last call
+static u32 lz4Fill(void *ctx, const u8 **data)
+{
+    Lz4Job *job = ctx;
+    uint32_t start = job->taken;
+    uint32_t len = job->inputSize - job->taken;
+    uint32_t written;
+
+    if (len == 0) {
+        return 0;
+    }
+    if (len > STREAM_CHUNK_SIZE) {
+        len = STREAM_CHUNK_SIZE;
+    }
+
+    if (job->command == CMD_PROGRAM_LZ4_STREAM) {
+        // The decoder is done with everything it was handed before
+        CONFIG_REGISTER->READ_INDEX = job->taken;
+
+        while ((written = CONFIG_REGISTER->WRITE_INDEX) == job->taken);
+        start = job->taken % STREAM_RING_SIZE;
+        if (len > written - job->taken) {
+            len = written - job->taken;
+        }
+        if (len > STREAM_RING_SIZE - start) {
+            len = STREAM_RING_SIZE - start;
+        }
+    }
+
+    *data = (const u8 *)(job->input + start);
+    job->taken += len;
+    return len;
+}
+
+// Programs and verifies each 64KB as it comes out of the decoder
+static s32 lz4Flush(void *ctx, const u8 *data, u32 size)
+{
+    Lz4Job *job = ctx;
+    uint32_t flashAddr = job->flashAddr + job->offset;
 
-    status = flasherProgram(dstAddr, srcAddr, imageSize);
-    if (status != XST_SUCCESS) {
-        xil_printf("FAILED LOADING QSPI\n\r");
+    if (programImage(flashAddr, (uint32_t)data, size, &job->crc) != XST_SUCCESS) {
+        job->error = ERROR_PROGRAM;
         return XST_FAILURE;
     }
 
+    job->offset += size;
+    showProgress(job->command, job->taken, job->inputSize, flashAddr + size);
     return XST_SUCCESS;
 }
 
+// Carry out a command on the image in place, 64KB at a time so progress can
+// be reported in between. Returns an ERROR_* code.
+static uint32_t run_chunks(uint32_t command, uint32_t flashAddr, uint32_t size, uint32_t *crc)
+{
+    uint32_t staging = (uint32_t)&_STAGING_START;
+
+    for (uint32_t offset = 0; offset < size; ) {
+        uint32_t len = (size - offset > STREAM_CHUNK_SIZE) ? STREAM_CHUNK_SIZE : size - offset;
+        uint32_t chunk = staging + offset;
+
+        switch (command) {
+        case CMD_PROGRAM_STREAM:
+            chunk = staging + (offset % STREAM_RING_SIZE);
+
+            // Wait for the host to finish loading this chunk
+            while (CONFIG_REGISTER->WRITE_INDEX - offset < len);
+            /* fall through */
+        case CMD_PROGRAM:
+            if (programImage(flashAddr + offset, chunk, len, crc) != XST_SUCCESS) {
+                return ERROR_PROGRAM;
+            }
+            // Hands the chunk back to the host
+            CONFIG_REGISTER->READ_INDEX = offset + len;
+            break;
+        case CMD_ERASE:
+            if (flasherErase(flashAddr + offset, len) != XST_SUCCESS) {
+                return ERROR_ERASE;
+            }
+            break;
+        case CMD_VERIFY:
+            if (flasherVerify(flashAddr + offset, chunk, len, crc) != XST_SUCCESS) {
+                return ERROR_VERIFY;
+            }
+            break;
+        case CMD_READ_BACK:
+            flasherReadBack(flashAddr + offset, chunk, len, crc);
+            break;
+        case CMD_CRC:
+            flasherCrc(flashAddr + offset, len, crc);
+            break;
+        }
+
+        offset += len;
+        showProgress(command, offset, size, flashAddr + offset);
+    }
+
+    return ERROR_NONE;
+}
+
+// Decompress the rest of the frame whose header job has read, programming
+// as it goes. Returns an ERROR_* code.
+static uint32_t run_lz4(Lz4Job *job, uint32_t flashAddr, uint32_t *crc)
+{
+    job->flashAddr = flashAddr;
+
+    if (lz4Decode(&job->stream) != XST_SUCCESS) {
+        // Whatever was programmed before the frame turned out bad stays,
+        // but a boot slot isn't committed
+        return job->error != ERROR_NONE ? job->error : ERROR_BAD_IMAGE;
+    }
+
+    *crc = job->crc;
+    CONFIG_REGISTER->READ_INDEX = job->inputSize;
+    showProgress(job->command, job->inputSize, job->inputSize, flashAddr + job->offset);
+    return ERROR_NONE;
+}
+
+// Carry out one command. Returns an ERROR_* code.
+static uint32_t run_command(uint32_t command, uint32_t flashAddr, uint32_t size)
+{
+    uint32_t stagingSize = (uint32_t)&_STAGING_END - (uint32_t)&_STAGING_START;
+    uint32_t imageSize = size;
+    uint32_t crc = 0;
+    uint32_t error;
+    SlotRecord records[SLOT_COUNT];
+    SlotRecord record;
+    Lz4Job job;
+    int slot = -1;
+
+    holdAddr = NO_HOLD;
+
+    if (commandName(command) == NULL) {
+        return ERROR_BAD_COMMAND;
+    }
+
+    // The staged image has to fit, the stream ring reuses its start
+    if ((command == CMD_PROGRAM || command == CMD_PROGRAM_LZ4 || command == CMD_VERIFY ||
+            command == CMD_READ_BACK) && size > stagingSize) {
+        return ERROR_BAD_RANGE;
+    }
+
+    // A frame says how big the image is in its header
+    if (isLz4(command)) {
+        memset(&job, 0, sizeof(job));
+        job.command = command;
+        job.input = (uint32_t)&_STAGING_START;
+        job.inputSize = size;
+        job.stream.fill = lz4Fill;
+        job.stream.flush = lz4Flush;
+        job.stream.ctx = &job;
+
+        if (lz4ReadHeader(&job.stream) != XST_SUCCESS || job.stream.contentSize == 0) {
+            return ERROR_BAD_IMAGE;
+        }
+        if (job.stream.contentSize > FLASH_SIZE) {
+            return ERROR_BAD_RANGE;
+        }
+        imageSize = (uint32_t)job.stream.contentSize;
+        xil_printf("LZ4 frame of %d bytes holds %d\n\r", size, imageSize);
+    }
+
+    if (flashAddr == FLASH_OFFSET_SLOT) {
+        if (!isProgram(command) || imageSize == 0 || imageSize > SLOT_IMAGE_MAX) {
+            return ERROR_BAD_RANGE;
+        }
+
+        readSlotRecords(records);
+        slot = slotInactive(records);
+        flashAddr = SLOT_BASE(slot);
+        CONFIG_REGISTER->SLOT = slot;
+        xil_printf("Writing slot %c at 0x%08X\n\r", SLOT_NAME(slot), flashAddr);
+
+        // The slot stops being bootable until its new record goes in, and
+        // the BootROM skips it until its boot header does
+        if (flasherErase(SLOT_RECORD(slot), sizeof(SlotRecord)) != XST_SUCCESS ||
+                flasherErase(flashAddr, SLOT_HEADER_SIZE) != XST_SUCCESS) {
+            return ERROR_ERASE;
+        }
+        holdAddr = flashAddr;
+    }
+
+    if (imageSize == 0 || imageSize > FLASH_SIZE || flashAddr > FLASH_SIZE - imageSize ||
+            (flashAddr % SECTOR_SIZE) != 0) {
+        return ERROR_BAD_RANGE;
+    }
+
+    if (isLz4(command)) {
+        error = run_lz4(&job, flashAddr, &crc);
+    } else {
+        error = run_chunks(command, flashAddr, size, &crc);
+    }
+    if (error != ERROR_NONE) {
+        return error;
+    }
+
+    // Everything after the boot header is verified, the header goes last
+    if (slot >= 0 && programHeld(imageSize, &crc) != XST_SUCCESS) {
+        return ERROR_PROGRAM;
+    }
+
+    CONFIG_REGISTER->CRC32 = crc;
+
+    // The image is verified, make it the one to boot
+    if (slot >= 0) {
+        slotRecordMake(&record, records, imageSize, crc);
+        if (flasherProgram(SLOT_RECORD(slot), (uint32_t)&record, sizeof(record), NULL) != XST_SUCCESS) {
+            return ERROR_PROGRAM;
+        }
+        CONFIG_REGISTER->SEQUENCE = record.sequence;
+        xil_printf("\n\rSlot %c committed, sequence %d", SLOT_NAME(slot), record.sequence);
+    }
+
+    return ERROR_NONE;
+}
+
 int main() {
-    uint32_t imageSize = 0;
-    int32_t status;
+    uint32_t command, flashAddr, size, error;
 
     Xil_DCacheDisable();
     Xil_ICacheDisable();
     Xil_DisableMMU();
 
+    // Clear the mailbox
+    CONFIG_REGISTER->COMMAND = 0x00;
+    CONFIG_REGISTER->CRC32 = 0x00;
+    CONFIG_REGISTER->WRITE_INDEX = 0x00;
+    CONFIG_REGISTER->READ_INDEX = 0x00;
+    CONFIG_REGISTER->ERROR = ERROR_NONE;
+    CONFIG_REGISTER->BYTES_DONE = 0x00;
+
     // Initialize QSPI driver
-    flasherInit();
+    if (flasherInit() != XST_SUCCESS) {
+        xil_printf("ERROR: QSPI flash initialization failed\n\r");
+        CONFIG_REGISTER->ERROR = ERROR_INIT;
+        CONFIG_REGISTER->STATUS = STATUS_FAILED;
+        return 0;
+    }
 
-    // Clear start and done flags
-    CONFIG_REGISTER->START = 0x00;
+    // The commands print their own progress, one line each
+    flasherSetVerbose(0);
 
-    xil_printf("Flasher Ready. Waiting for JTAG upload...\n\r");
+    CONFIG_REGISTER->STATUS = STATUS_READY;
+    xil_printf("Flasher Ready. Waiting for JTAG commands...\n\r");
 
-    // Wait for something (OpenOCD) to poke the Start Register
-    while(CONFIG_REGISTER->START == 0);
+    while (1) {
+        // Wait for something (OpenOCD) to poke the Command Register
+        while (CONFIG_REGISTER->COMMAND == 0);
 
-    // Get the size of what was written
-    imageSize = CONFIG_REGISTER->IMAGE_SIZE;
+        command = CONFIG_REGISTER->COMMAND;
+        flashAddr = CONFIG_REGISTER->FLASH_OFFSET;
+        size = CONFIG_REGISTER->IMAGE_SIZE;
 
-    status = copy_flash(QSPI_ADDR, (uint32_t)&_STAGING_START, imageSize);
-    if (status != XST_SUCCESS) {
-        xil_printf("Failed to copy image to flash: (addr: 0x%08X, size: %d)",
-            &_STAGING_START, imageSize);
-            return 0;
+        XTime_GetTime(&commandStart);
+        CONFIG_REGISTER->CRC32 = 0x00;
+        CONFIG_REGISTER->READ_INDEX = 0x00;
+        CONFIG_REGISTER->ERROR = ERROR_NONE;
+        CONFIG_REGISTER->SLOT = SLOT_NONE;
+        CONFIG_REGISTER->SEQUENCE = 0x00;
+        reportProgress(0);
+        CONFIG_REGISTER->STATUS = STATUS_BUSY;
+        CONFIG_REGISTER->COMMAND = 0x00;
+
+        xil_printf("Command %d: %d bytes at flash offset 0x%08X\n\r", command, size, flashAddr);
+
+        error = run_command(command, flashAddr, size);
+        reportProgress(CONFIG_REGISTER->BYTES_DONE);
+
+        if (error != ERROR_NONE) {
+            xil_printf("\n\rCOMMAND FAILED after %d ms: error %d\n\r", elapsedMs(), error);
+            CONFIG_REGISTER->ERROR = error;
+            CONFIG_REGISTER->STATUS = STATUS_FAILED;
+            continue;
+        }
+
+        xil_printf("\n\r%s done in %d ms, CRC32 0x%08X over %d bytes\n\r",
+                commandName(command), elapsedMs(), CONFIG_REGISTER->CRC32, size);
+        CONFIG_REGISTER->STATUS = STATUS_DONE;
+
+        if (isProgram(command)) {
+            xil_printf("\n\r******************************************\n\r");
+            xil_printf("   FLASH UPDATE SUCCESSFUL!               \n\r");
+            xil_printf("   You may now power cycle the board.     \n\r");
+            xil_printf("******************************************\n\r");
+        }
     }
 
-    xil_printf("\n\r******************************************\n\r");
-    xil_printf("   FLASH UPDATE SUCCESSFUL!               \n\r");
-    xil_printf("   You may now power cycle the board.     \n\r");
-    xil_printf("******************************************\n\r");
     return 0;
-}
\ No newline at end of file
+}
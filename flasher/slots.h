@@ -0,0 +1,92 @@
+#ifndef SLOTS_H
+#define SLOTS_H
+
+#include <stdint.h>
+
+/*
+ * A/B boot slots, shared by the flasher, the FSBL and the app's network
+ * update.
+ *
+ * The 16MB flash holds two complete BOOT.BIN images, slot A at 0 and slot B
+ * at 8MB. Both are on the 32KB grid the BootROM searches, so either can be
+ * booted by pointing the MultiBoot register at it. The last 64KB block of
+ * each slot holds its version record. An update erases the record of the
+ * slot it is about to write and the sector holding the slot's boot header,
+ * so neither the FSBL nor the BootROM will pick the slot meanwhile. It
+ * writes and verifies the rest of the image, then the boot header, and
+ * only then programs a record with a sequence number one higher than the
+ * other slot's. A slot whose update was cut short has no record, and no
+ * boot header either, so the BootROM moves on to the other slot instead of
+ * starting a half-written FSBL.
+ *
+ * The FSBL boots the slot with the highest valid record. With no records
+ * (a plain BOOT.BIN at 0) it boots what the BootROM found, as before.
+ */
+
+#define SLOT_COUNT          2
+#define SLOT_SIZE           0x00800000 // 8MB
+#define SLOT_RECORD_OFFSET  0x007F0000 // A block of its own, so it erases separately
+#define SLOT_IMAGE_MAX      SLOT_RECORD_OFFSET
+#define SLOT_HEADER_SIZE    0x1000     // The sector with the boot header, written last
+
+#define SLOT_BASE(slot)     ((uint32_t)(slot) * SLOT_SIZE)
+#define SLOT_RECORD(slot)   (SLOT_BASE(slot) + SLOT_RECORD_OFFSET)
+#define SLOT_NAME(slot)     ('A' + (slot))
+
+#define SLOT_RECORD_MAGIC   0x544F4C53 // "SLOT"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;  // Higher is newer
+    uint32_t imageSize;
+    uint32_t crc32;     // CRC-32 of the image, as zlib computes it
+    uint32_t check;     // slotRecordCheck() of the above
+} SlotRecord;
+
+static inline uint32_t slotRecordCheck(const SlotRecord *record)
+{
+    return ~(record->magic ^ record->sequence ^ record->imageSize ^ record->crc32);
+}
+
+static inline int slotRecordValid(const SlotRecord *record)
+{
+    return record->magic == SLOT_RECORD_MAGIC && record->check == slotRecordCheck(record) &&
+            record->imageSize != 0 && record->imageSize <= SLOT_IMAGE_MAX;
+}
+
+/* The slot with the newest valid record, or -1 if neither has one */
+static inline int slotNewest(const SlotRecord records[SLOT_COUNT])
+{
+    int newest = -1;
+
+    for (int slot = 0; slot < SLOT_COUNT; slot++) {
+        if (slotRecordValid(&records[slot]) &&
+                (newest < 0 || records[slot].sequence > records[newest].sequence)) {
+            newest = slot;
+        }
+    }
+    return newest;
+}
+
+/* The slot the next update goes to: the one not in use, or A on a fresh flash */
+static inline int slotInactive(const SlotRecord records[SLOT_COUNT])
+{
+    int newest = slotNewest(records);
+
+    return (newest < 0) ? 0 : (newest + 1) % SLOT_COUNT;
+}
+
+/* The record that makes slot the newest once its image is in place */
+static inline void slotRecordMake(SlotRecord *record, const SlotRecord records[SLOT_COUNT],
+        uint32_t imageSize, uint32_t crc32)
+{
+    int newest = slotNewest(records);
+
+    record->magic = SLOT_RECORD_MAGIC;
+    record->sequence = (newest < 0) ? 1 : records[newest].sequence + 1;
+    record->imageSize = imageSize;
+    record->crc32 = crc32;
+    record->check = slotRecordCheck(record);
+}
+
+#endif /* SLOTS_H */
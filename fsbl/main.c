@@ -118,6 +118,7 @@
 #include "xil_exception.h"
 #include "xstatus.h"
 #include "fsbl_hooks.h"
+#include "slots.h"
 #ifndef SDT
 #include "xtime_l.h"
 #else
@@ -167,6 +168,7 @@ extern int ps7_post_config();
 #endif
 
 static void Update_MultiBootRegister(void);
+static void SelectBootSlot(void);
 /* Exception handlers */
 static void RegisterHandlers(void);
 static void Undef_Handler (void);
@@ -184,6 +186,8 @@ void  CheckWDTReset(void);
 #endif
 
 u32 NextValidImageCheck(void);
+u32 ImageCheckID(u32 FlashOffsetAddress);
+u32 HeaderChecksum(u32 FlashOffsetAddress);
 
 u32 DDRInitCheck(void);
 
@@ -206,6 +210,12 @@ u32 PcapCtrlRegVal;
 
 u8 SystemInitFlag;
 
+/*
+ * A/B slot picked from the version records, or -1 when booting the image
+ * the BootROM found
+ */
+static int BootSlot = -1;
+
 extern ImageMoverType MoveImage;
 extern XDcfg *DcfgInstPtr;
 extern u8 BitstreamFlag;
@@ -558,6 +568,13 @@ int main(void)
 	 */
 	SystemInitFlag = 1;
 
+	/*
+	 * Boot the newest A/B slot
+	 */
+	if (FlashReadBaseAddress == XPS_QSPI_LINEAR_BASEADDR) {
+		SelectBootSlot();
+	}
+
 	/*
 	 * Load boot image
 	 */
@@ -624,10 +641,22 @@ void FsblFallback(void)
 		FsblHookFallback();
 	}
 
-	/*
-	 * update the Multiboot Register for Golden search hunt
-	 */
-	Update_MultiBootRegister();
+	if (BootSlot >= 0) {
+		/*
+		 * The slot picked from its record failed, go straight to
+		 * the other one
+		 */
+		XDcfg_WriteReg(DcfgInstPtr->Config.BaseAddr,
+				XDCFG_MULTIBOOT_ADDR_OFFSET,
+				SLOT_BASE((BootSlot + 1) % SLOT_COUNT) / GOLDEN_IMAGE_OFFSET);
+		fsbl_printf(DEBUG_GENERAL,"Slot %c failed, falling back to slot %c\r\n",
+				SLOT_NAME(BootSlot), SLOT_NAME((BootSlot + 1) % SLOT_COUNT));
+	} else {
+		/*
+		 * update the Multiboot Register for Golden search hunt
+		 */
+		Update_MultiBootRegister();
+	}
 
 	/*
 	 * Notify Boot ROM something is wrong
@@ -1061,6 +1090,66 @@ static void Update_MultiBootRegister(void)
 }
 
 
+/******************************************************************************
+*
+* This function points the MultiBoot register at the A/B slot with the newest
+* valid version record (see slots.h), so LoadBootImage() loads that slot
+* without any image search. A slot only counts if its boot header is intact
+* too. Without records the image the BootROM found is booted.
+*
+* After a fallback the BootROM has already moved on to the other slot, so the
+* records are ignored once, or the failed slot would be picked again.
+*
+* @param None
+*
+* @return None
+*
+****************************************************************************/
+static void SelectBootSlot(void)
+{
+	SlotRecord Records[SLOT_COUNT];
+	u32 RebootStatusReg;
+	int Slot;
+
+	if (Silicon_Version == SILICON_VERSION_1) {
+		return;
+	}
+
+	RebootStatusReg = Xil_In32(REBOOT_STATUS_REG);
+	if ((RebootStatusReg & FSBL_FAIL_MASK) != 0) {
+		fsbl_printf(DEBUG_GENERAL,"Fallback boot, slot records ignored\r\n");
+		Xil_Out32(REBOOT_STATUS_REG, RebootStatusReg & ~(FSBL_FAIL_MASK));
+		return;
+	}
+
+	for (Slot = 0; Slot < SLOT_COUNT; Slot++) {
+		MoveImage(SLOT_RECORD(Slot), (u32)&Records[Slot], sizeof(SlotRecord));
+
+		if (slotRecordValid(&Records[Slot]) &&
+				((ImageCheckID(SLOT_BASE(Slot)) != XST_SUCCESS) ||
+				(HeaderChecksum(SLOT_BASE(Slot)) != XST_SUCCESS))) {
+			fsbl_printf(DEBUG_GENERAL,"Slot %c has a record but no image\r\n",
+					SLOT_NAME(Slot));
+			Records[Slot].magic = 0;
+		}
+	}
+
+	Slot = slotNewest(Records);
+	if (Slot < 0) {
+		fsbl_printf(DEBUG_INFO,"No slot records\r\n");
+		return;
+	}
+
+	fsbl_printf(DEBUG_GENERAL,"Booting slot %c, sequence %d\r\n",
+			SLOT_NAME(Slot), Records[Slot].sequence);
+
+	XDcfg_WriteReg(DcfgInstPtr->Config.BaseAddr,
+			XDCFG_MULTIBOOT_ADDR_OFFSET,
+			SLOT_BASE(Slot) / GOLDEN_IMAGE_OFFSET);
+	BootSlot = Slot;
+}
+
+
 /******************************************************************************
 *
 * This function reset the CPU and goes for Boot ROM fallback handling
@@ -55,6 +55,7 @@
 #if defined(XPAR_PS7_QSPI_LINEAR_0_S_AXI_BASEADDR) || defined(XPAR_PS7_QSPI_LINEAR_0_BASEADDRESS)
 #include "xqspips_hw.h"
 #include "xqspips.h"
+#include "xil_mem.h"
 
 /************************** Constant Definitions *****************************/
 
@@ -606,9 +607,9 @@ u32 QspiAccess( u32 SourceAddress, u32 DestinationAddress, u32 LengthBytes)
 			LengthBytes += (4 - (LengthBytes & 0x00000003));
 		}
 
-		memcpy((void*)DestinationAddress,
+		Xil_MemCpyNeon((void*)DestinationAddress,
 		      (const void*)(SourceAddress + FlashReadBaseAddress),
-		      (size_t)LengthBytes);
+		      LengthBytes);
 	} else {
 		/*
 		 * Non Linear access
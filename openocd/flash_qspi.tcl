@@ -1,6 +1,201 @@
 source ./arty-z7.cfg
 
+# Memory access through the DAP's AHB-AP, which reaches DDR without halting
+# the CPU. The flasher keeps programming while the image streams in.
+target create zynq.ahb mem_ap -dap zynq.dap -ap-num 0
+
+# Must match flasher/flasher.h
+set CONFIG_COMMAND      0x00200000
+set CONFIG_IMAGE_SIZE   0x00200004
+set CONFIG_CRC32        0x00200008
+set CONFIG_WRITE_INDEX  0x0020000C
+set CONFIG_READ_INDEX   0x00200010
+set CONFIG_FLASH_OFFSET 0x00200014
+set CONFIG_STATUS       0x00200018
+set CONFIG_ERROR        0x0020001C
+set CONFIG_BYTES_DONE   0x00200020
+set CONFIG_ELAPSED_LO   0x00200024
+set CONFIG_ELAPSED_HI   0x00200028
+set CONFIG_SLOT         0x0020002C
+set CONFIG_SEQUENCE     0x00200030
+set STAGING_START       0x00200400
+
+set CMD_PROGRAM         0x01
+set CMD_PROGRAM_STREAM  0x02
+set CMD_ERASE           0x03
+set CMD_VERIFY          0x04
+set CMD_READ_BACK       0x05
+set CMD_CRC             0x06
+set CMD_PROGRAM_LZ4     0x07
+set CMD_PROGRAM_LZ4_STREAM 0x08
+
+# Program the inactive boot slot and commit its record (flasher/slots.h)
+set FLASH_OFFSET_SLOT   0xFFFFFFFF
+set SLOT_NONE           0xFFFFFFFF
+
+set STATUS_BOOTING      0x00
+set STATUS_READY        0x01
+set STATUS_BUSY         0x02
+set STATUS_DONE         0x03
+set STATUS_FAILED       0x04
+
+set STREAM_CHUNK_SIZE   0x00010000
+set STREAM_RING_SIZE    0x00100000
+
+# Global timer counts per millisecond
+set COUNTS_PER_MS       325000
+
+proc read_word {addr} {
+    return [lindex [zynq.ahb read_memory $addr 32 1] 0]
+}
+
+# Wait for the flasher to come up after it was started
+proc flasher_wait_ready {timeout_ms} {
+    global CONFIG_STATUS CONFIG_ERROR STATUS_READY STATUS_FAILED
+
+    for {set waited 0} {${waited} < ${timeout_ms}} {incr waited 10} {
+        set status [read_word ${CONFIG_STATUS}]
+
+        if {${status} == ${STATUS_READY}} {
+            return 1
+        }
+        if {${status} == ${STATUS_FAILED}} {
+            echo "Flasher failed to start: error [read_word ${CONFIG_ERROR}]"
+            return 0
+        }
+        sleep 10
+    }
+    echo "Flasher didn't start within ${timeout_ms} ms"
+    return 0
+}
+
+# Hand the flasher a command. It's taken as soon as the flasher is idle.
+proc flasher_start {command offset size} {
+    global CONFIG_COMMAND CONFIG_IMAGE_SIZE CONFIG_FLASH_OFFSET
+
+    zynq.ahb mww ${CONFIG_FLASH_OFFSET} ${offset}
+    zynq.ahb mww ${CONFIG_IMAGE_SIZE} ${size}
+    zynq.ahb mww ${CONFIG_COMMAND} ${command}
+}
+
+# Nonzero once the flasher has taken the last command and finished it
+proc flasher_finished {} {
+    global CONFIG_COMMAND CONFIG_STATUS STATUS_DONE STATUS_FAILED
+
+    if {[read_word ${CONFIG_COMMAND}] != 0} {
+        return 0
+    }
+    set status [read_word ${CONFIG_STATUS}]
+    return [expr {${status} == ${STATUS_DONE} || ${status} == ${STATUS_FAILED}}]
+}
+
+# Poll the mailbox until the command finishes, echoing progress every 10%.
+# Returns 1 on success. The CRC32 is left in the mailbox.
+proc flasher_wait {size} {
+    global CONFIG_STATUS CONFIG_ERROR CONFIG_CRC32 CONFIG_BYTES_DONE
+    global CONFIG_ELAPSED_LO CONFIG_ELAPSED_HI STATUS_DONE COUNTS_PER_MS
+    global CONFIG_SLOT CONFIG_SEQUENCE SLOT_NONE
+
+    set shown -1
+    while {![flasher_finished]} {
+        set percent [expr {[read_word ${CONFIG_BYTES_DONE}] * 100 / ${size}}]
+
+        if {${percent} / 10 != ${shown}} {
+            set shown [expr {${percent} / 10}]
+            echo "  ${percent}%"
+        }
+        sleep 20
+    }
+
+    set elapsed [expr {([read_word ${CONFIG_ELAPSED_HI}] << 32 | [read_word ${CONFIG_ELAPSED_LO}]) / ${COUNTS_PER_MS}}]
+    if {[read_word ${CONFIG_STATUS}] != ${STATUS_DONE}} {
+        echo "FAILED after ${elapsed} ms: error [read_word ${CONFIG_ERROR}], see the flasher's console"
+        return 0
+    }
+    echo [format "Done in %d ms, CRC32 0x%08X" ${elapsed} [read_word ${CONFIG_CRC32}]]
+    set slot [read_word ${CONFIG_SLOT}]
+    if {${slot} != ${SLOT_NONE}} {
+        echo [format "Boot slot %c now holds the newest image, sequence %d" \
+                [expr {65 + ${slot}}] [read_word ${CONFIG_SEQUENCE}]]
+    }
+    return 1
+}
+
+# Run a command that needs no data from the host and wait for it, e.g.
+# flasher_run ${CMD_CRC} 0 [file size ../BOOT.BIN]
+proc flasher_run {command offset size} {
+    flasher_start ${command} ${offset} ${size}
+    return [flasher_wait ${size}]
+}
+
+# Copy a flash range to a file on the host
+proc flasher_read_back {offset size path} {
+    global CMD_READ_BACK STAGING_START
+
+    if {![flasher_run ${CMD_READ_BACK} ${offset} ${size}]} {
+        return 0
+    }
+    targets zynq.ahb
+    dump_image ${path} ${STAGING_START} ${size}
+    return 1
+}
+
+# Feed the image to the flasher a chunk at a time through the ring at the
+# start of the staging zone. A chunk is written once the flasher has
+# finished with whatever was in its place in the ring before. offset is a
+# flash offset, or FLASH_OFFSET_SLOT for the inactive boot slot. A .lz4 file
+# (from tools/lz4pack) is sent as it is and decompressed by the flasher.
+proc stream_image {bin_path offset} {
+    global CONFIG_WRITE_INDEX CONFIG_READ_INDEX CONFIG_STATUS STATUS_FAILED
+    global STAGING_START CMD_PROGRAM_STREAM CMD_PROGRAM_LZ4_STREAM
+    global STREAM_CHUNK_SIZE STREAM_RING_SIZE
+
+    set size [file size ${bin_path}]
+    set command ${CMD_PROGRAM_STREAM}
+    if {[file extension ${bin_path}] eq ".lz4"} {
+        set command ${CMD_PROGRAM_LZ4_STREAM}
+    }
+    set chunk_path "stream_chunk.bin"
+    set in [open ${bin_path} rb]
+    set written 0
+
+    zynq.ahb mww ${CONFIG_WRITE_INDEX} 0
+    flasher_start ${command} ${offset} ${size}
+
+    targets zynq.ahb
+    while {${written} < ${size}} {
+        set len ${STREAM_CHUNK_SIZE}
+        if {${size} - ${written} < ${len}} {
+            set len [expr {${size} - ${written}}]
+        }
+
+        if {[read_word ${CONFIG_STATUS}] == ${STATUS_FAILED}} {
+            break
+        }
+        # Wait for the chunk's place in the ring to be free
+        if {${written} + ${len} - [read_word ${CONFIG_READ_INDEX}] > ${STREAM_RING_SIZE}} {
+            sleep 5
+            continue
+        }
+
+        set out [open ${chunk_path} wb]
+        puts -nonewline ${out} [read ${in} ${len}]
+        close ${out}
+        load_image ${chunk_path} [expr {${STAGING_START} + ${written} % ${STREAM_RING_SIZE}}] bin
+
+        incr written ${len}
+        zynq.ahb mww ${CONFIG_WRITE_INDEX} ${written}
+    }
+    close ${in}
+    file delete ${chunk_path}
+
+    echo "Sent ${written} of ${size} bytes, waiting for the flasher"
+    return [flasher_wait ${size}]
+}
+
 proc flash_qspi {flasher_path bin_path} {
+    global CONFIG_STATUS STATUS_BOOTING FLASH_OFFSET_SLOT
+
     adapter speed 10000
 
     # Need to call this in the tcl script
@@ -13,23 +208,21 @@ proc flash_qspi {flasher_path bin_path} {
     # Load the flasher application into DDR
     echo "Loading ${flasher_path} into DDR"
     load_image ${flasher_path}
+    # Forget the status a previous run left behind
+    mww ${CONFIG_STATUS} ${STATUS_BOOTING}
     # Start the flasher application so it's
-    # ready to copy data
+    # ready to take commands
     resume 0x00100000
-    sleep 1000
-
-    # Load the BOOT.BIN file into DDR
-    halt
-    echo "Loading ${bin_path} into DDR"
-    load_image ${bin_path} 0x00200400
-    # Write the size of the file to the size register
-    mww 0x00200004 [file size ${bin_path}]
 
-    # Trigger the flasher to copy the BOOT.BIN into QSPI flash
-    mww 0x00200000 0x01
-    resume
+    if {[flasher_wait_ready 5000]} {
+        # Stream the compressed BOOT.BIN to the flasher, which programs
+        # each chunk into the inactive boot slot while the next ones are
+        # loaded
+        echo "Streaming ${bin_path} to the flasher"
+        stream_image ${bin_path} ${FLASH_OFFSET_SLOT}
+    }
 
     shutdown
 }
 
-flash_qspi "../flasher/flasher.elf" "../BOOT.BIN"
\ No newline at end of file
+flash_qspi "../flasher/flasher.elf" "../BOOT.BIN.lz4"
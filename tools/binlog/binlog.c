@@ -0,0 +1,323 @@
+/*
+ * Decoder for the app's deferred-format log (app/src/BinLog.h).
+ *
+ *	binlog app.elf			print the OpenOCD command that dumps the ring
+ *	binlog app.elf binlog.bin	decode a dump of the ring
+ *
+ * The ELF supplies the format strings (the unloaded .binlog section), the
+ * address and size of binlogRing, and the loaded sections that %s arguments
+ * point into. Timestamps are printed in microseconds since the first record
+ * shown, from the lower 32 bits of the global timer, so gaps of more than
+ * 2^32 ticks between two records are lost.
+ */
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BINLOG_MAX_ARGS		8
+
+/* Global timer rate: half the 650 MHz CPU clock. Override with -f <hz>. */
+#define DEFAULT_TIMER_HZ	325000000u
+
+struct Elf {
+	uint8_t *data;
+	size_t size;
+	const Elf32_Ehdr *ehdr;
+	const Elf32_Shdr *shdrs;
+	const char *shstrtab;
+};
+
+static uint8_t *readFile(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	uint8_t *data;
+	long len;
+
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	data = malloc(len + 1);
+	if (!data || fread(data, 1, len, f) != (size_t)len) {
+		fprintf(stderr, "%s: read failed\n", path);
+		fclose(f);
+		free(data);
+		return NULL;
+	}
+	data[len] = 0;
+
+	fclose(f);
+	*size = len;
+	return data;
+}
+
+static int elfOpen(struct Elf *elf, const char *path)
+{
+	elf->data = readFile(path, &elf->size);
+	if (!elf->data)
+		return -1;
+
+	elf->ehdr = (const Elf32_Ehdr *)elf->data;
+	if (elf->size < sizeof(Elf32_Ehdr) || memcmp(elf->ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+			elf->ehdr->e_ident[EI_CLASS] != ELFCLASS32 ||
+			elf->ehdr->e_ident[EI_DATA] != ELFDATA2LSB) {
+		fprintf(stderr, "%s: not a little-endian 32-bit ELF\n", path);
+		return -1;
+	}
+
+	elf->shdrs = (const Elf32_Shdr *)(elf->data + elf->ehdr->e_shoff);
+	elf->shstrtab = (const char *)elf->data + elf->shdrs[elf->ehdr->e_shstrndx].sh_offset;
+	return 0;
+}
+
+static const Elf32_Shdr *elfSection(const struct Elf *elf, const char *name)
+{
+	for (int i = 0; i < elf->ehdr->e_shnum; i++) {
+		if (strcmp(elf->shstrtab + elf->shdrs[i].sh_name, name) == 0)
+			return &elf->shdrs[i];
+	}
+	return NULL;
+}
+
+static const Elf32_Sym *elfSymbol(const struct Elf *elf, const char *name)
+{
+	for (int i = 0; i < elf->ehdr->e_shnum; i++) {
+		const Elf32_Shdr *sh = &elf->shdrs[i];
+		const Elf32_Sym *syms;
+		const char *strtab;
+
+		if (sh->sh_type != SHT_SYMTAB)
+			continue;
+
+		syms = (const Elf32_Sym *)(elf->data + sh->sh_offset);
+		strtab = (const char *)elf->data + elf->shdrs[sh->sh_link].sh_offset;
+		for (uint32_t j = 0; j < sh->sh_size / sizeof(Elf32_Sym); j++) {
+			if (strcmp(strtab + syms[j].st_name, name) == 0)
+				return &syms[j];
+		}
+	}
+	return NULL;
+}
+
+/* A NUL-terminated string at a target address in a loaded section */
+static const char *elfString(const struct Elf *elf, uint32_t addr)
+{
+	for (int i = 0; i < elf->ehdr->e_shnum; i++) {
+		const Elf32_Shdr *sh = &elf->shdrs[i];
+
+		if (!(sh->sh_flags & SHF_ALLOC) || sh->sh_type != SHT_PROGBITS)
+			continue;
+		if (addr >= sh->sh_addr && addr < sh->sh_addr + sh->sh_size) {
+			const char *s = (const char *)elf->data + sh->sh_offset + (addr - sh->sh_addr);
+
+			if (memchr(s, 0, sh->sh_addr + sh->sh_size - addr))
+				return s;
+		}
+	}
+	return NULL;
+}
+
+/* Number of arguments a format string takes */
+static int countArgs(const char *fmt)
+{
+	int n = 0;
+
+	for (; *fmt; fmt++) {
+		if (*fmt != '%')
+			continue;
+		if (*++fmt == '%')
+			continue;
+		fmt += strspn(fmt, "-+ #0123456789.hlzjt");
+		if (*fmt == 0)
+			break;
+		n++;
+	}
+	return n;
+}
+
+/* printf() with each argument taken from a 32-bit word */
+static void format(const struct Elf *elf, const char *fmt, const uint32_t *args)
+{
+	while (*fmt) {
+		char spec[32];
+		size_t len;
+
+		if (*fmt != '%') {
+			if (*fmt != '\r')
+				putchar(*fmt);
+			fmt++;
+			continue;
+		}
+		if (fmt[1] == '%') {
+			putchar('%');
+			fmt += 2;
+			continue;
+		}
+
+		/* Copy the flags, width and precision, drop the length modifiers */
+		len = 1 + strspn(fmt + 1, "-+ #0123456789.");
+		if (len >= sizeof(spec) - 2)
+			len = sizeof(spec) - 2;
+		memcpy(spec, fmt, len);
+		fmt += len;
+		fmt += strspn(fmt, "hlzjt");
+		if (*fmt == 0)
+			break;
+		spec[len] = *fmt;
+		spec[len + 1] = 0;
+
+		switch (*fmt) {
+		case 'd':
+		case 'i':
+		case 'c':
+			printf(spec, (int32_t)*args);
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			printf(spec, *args);
+			break;
+		case 'p':
+			printf("0x%08x", *args);
+			break;
+		case 's': {
+			const char *s = elfString(elf, *args);
+
+			if (s)
+				printf(spec, s);
+			else
+				printf("<0x%08x>", *args);
+			break;
+		}
+		default:
+			printf("%s", spec);
+			break;
+		}
+		args++;
+		fmt++;
+	}
+}
+
+static int printDumpCommand(const struct Elf *elf)
+{
+	const Elf32_Sym *ring = elfSymbol(elf, "binlogRing");
+
+	if (!ring) {
+		fprintf(stderr, "no binlogRing in the ELF, was BinLog.c linked in?\n");
+		return 1;
+	}
+
+	printf("halt\ndump_image binlog.bin 0x%08x %u\n", ring->st_value, ring->st_size);
+	return 0;
+}
+
+static int decode(const struct Elf *elf, const char *dumpPath, uint32_t timerHz)
+{
+	const Elf32_Shdr *fmtSection = elfSection(elf, ".binlog");
+	const Elf32_Sym *ring = elfSymbol(elf, "binlogRing");
+	const char *fmts;
+	uint32_t fmtSize, words, head, idx, skipped = 0;
+	const uint32_t *buf;
+	uint32_t *dump;
+	size_t dumpSize;
+	uint64_t time = 0;
+	uint32_t lastStamp = 0;
+	int first = 1;
+
+	if (!fmtSection || !ring) {
+		fprintf(stderr, "no .binlog section or binlogRing in the ELF\n");
+		return 1;
+	}
+	fmts = (const char *)elf->data + fmtSection->sh_offset;
+	fmtSize = fmtSection->sh_size;
+
+	dump = (uint32_t *)readFile(dumpPath, &dumpSize);
+	if (!dump)
+		return 1;
+	if (dumpSize != ring->st_size) {
+		fprintf(stderr, "%s is %zu bytes, binlogRing is %u\n", dumpPath, dumpSize, ring->st_size);
+		return 1;
+	}
+
+	head = dump[0];
+	buf = dump + 1;
+	words = (dumpSize - sizeof(uint32_t)) / sizeof(uint32_t);
+	idx = head > words ? head - words : 0;
+
+	while (idx < head) {
+		uint32_t hdr = buf[idx % words];
+		uint32_t offset = hdr >> 4;
+		uint32_t nargs = hdr & 0xf;
+		uint32_t args[BINLOG_MAX_ARGS];
+		const char *fmt;
+
+		/* After a wrap the oldest record is usually cut short. Skip words
+		 * until one looks like the start of a record. */
+		if (offset == 0 || offset >= fmtSize || fmts[offset - 1] != 0 ||
+				nargs > BINLOG_MAX_ARGS || (int)nargs != countArgs(fmts + offset) ||
+				head - idx < 2 + nargs) {
+			skipped++;
+			idx++;
+			continue;
+		}
+		fmt = fmts + offset;
+
+		if (first) {
+			lastStamp = buf[(idx + 1) % words];
+			first = 0;
+		}
+		time += (uint32_t)(buf[(idx + 1) % words] - lastStamp);
+		lastStamp = buf[(idx + 1) % words];
+
+		for (uint32_t i = 0; i < nargs; i++)
+			args[i] = buf[(idx + 2 + i) % words];
+
+		printf("%12.3f  ", (double)time * 1e6 / timerHz);
+		format(elf, fmt, args);
+		if (fmt[strlen(fmt) - 1] != '\n')
+			putchar('\n');
+
+		idx += 2 + nargs;
+	}
+
+	if (skipped)
+		fprintf(stderr, "skipped %u words of partial records\n", skipped);
+	if (head > words)
+		fprintf(stderr, "ring wrapped, %u older words lost\n", head - words);
+
+	free(dump);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t timerHz = DEFAULT_TIMER_HZ;
+	struct Elf elf;
+
+	if (argc >= 3 && strcmp(argv[1], "-f") == 0) {
+		timerHz = strtoul(argv[2], NULL, 0);
+		argc -= 2;
+		argv += 2;
+	}
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: %s [-f timer_hz] app.elf [binlog.bin]\n", argv[0]);
+		return 2;
+	}
+
+	if (elfOpen(&elf, argv[1]) != 0)
+		return 1;
+
+	if (argc == 2)
+		return printDumpCommand(&elf);
+
+	return decode(&elf, argv[2], timerHz);
+}
@@ -0,0 +1,293 @@
+/*
+ * Replays an allocation trace against heap_4 and heap_tlsf and reports the
+ * per-call latency of each.
+ *
+ * Trace lines are "M <addr> <size>" for an allocation of <size> bytes (as
+ * requested, before rounding) that returned <addr>, and "F <addr>" for a
+ * free, which is what heap_tlsf.c prints on target with tlsfRECORD_TRACE set
+ * to 1. Anything else on a line (UART noise, other
+ * prints) is ignored. Addresses are only used to pair frees with their
+ * allocations.
+ *
+ * Usage:
+ *   heapbench <trace file> [-r repeats]
+ *   heapbench -g <operations> [-s seed] [-r repeats]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+
+typedef struct {
+	const char *name;
+	void *(*malloc)(size_t);
+	void (*free)(void *);
+	void (*stats)(HeapStats_t *);
+} Allocator;
+
+/* Both heaps export the FreeRTOS names, the Makefile renames them per object */
+void *heap4_pvPortMalloc(size_t);
+void heap4_vPortFree(void *);
+void heap4_vPortGetHeapStats(HeapStats_t *);
+void *tlsf_pvPortMalloc(size_t);
+void tlsf_vPortFree(void *);
+void tlsf_vPortGetHeapStats(HeapStats_t *);
+
+static const Allocator allocators[] = {
+	{ "heap_4", heap4_pvPortMalloc, heap4_vPortFree, heap4_vPortGetHeapStats },
+	{ "tlsf", tlsf_pvPortMalloc, tlsf_vPortFree, tlsf_vPortGetHeapStats },
+};
+
+#define NUM_ALLOCATORS (sizeof(allocators) / sizeof(allocators[0]))
+
+typedef struct {
+	uint8_t isAlloc;
+	uint32_t slot;	/* Index into the live pointer table */
+	uint32_t size;
+} TraceOp;
+
+static TraceOp *ops;
+static size_t numOps;
+static size_t numSlots;
+
+static void addOp(uint8_t isAlloc, uint32_t slot, uint32_t size)
+{
+	static size_t capacity;
+
+	if (numOps == capacity) {
+		capacity = capacity ? capacity * 2 : 4096;
+		ops = realloc(ops, capacity * sizeof(*ops));
+		if (!ops) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+
+	ops[numOps].isAlloc = isAlloc;
+	ops[numOps].slot = slot;
+	ops[numOps].size = size;
+	numOps++;
+}
+
+/* Address -> slot lookup for parsing. Linear probing, sized generously. */
+#define ADDR_TABLE_SIZE (1 << 20)
+static uint64_t addrKeys[ADDR_TABLE_SIZE];
+static uint32_t addrSlots[ADDR_TABLE_SIZE];
+
+static uint32_t *addrLookup(uint64_t addr, int insert)
+{
+	uint32_t i = (uint32_t)((addr >> 3) * 2654435761u) & (ADDR_TABLE_SIZE - 1);
+
+	while (addrKeys[i] != 0 && addrKeys[i] != addr)
+		i = (i + 1) & (ADDR_TABLE_SIZE - 1);
+
+	if (addrKeys[i] == 0) {
+		if (!insert)
+			return NULL;
+		addrKeys[i] = addr;
+	}
+
+	return &addrSlots[i];
+}
+
+static void loadTrace(const char *path)
+{
+	char line[256];
+	unsigned long long addr;
+	unsigned size;
+	uint32_t *slot;
+	FILE *f = fopen(path, "r");
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		char *p = line;
+
+		/* Tolerate timestamps or prompts in front of the record */
+		while (*p && *p != 'M' && *p != 'F')
+			p++;
+
+		if (sscanf(p, "M %llx %u", &addr, &size) == 2) {
+			/* Failed allocations on target don't need replaying */
+			if (addr == 0)
+				continue;
+			slot = addrLookup(addr, 1);
+			*slot = (uint32_t)numSlots++;
+			addOp(1, *slot, size);
+		} else if (sscanf(p, "F %llx", &addr) == 1) {
+			slot = addrLookup(addr, 0);
+			if (slot && *slot != UINT32_MAX) {
+				addOp(0, *slot, 0);
+				*slot = UINT32_MAX;
+			}
+		}
+	}
+
+	fclose(f);
+}
+
+/*
+ * A churn pattern shaped like the app's: mostly small lwIP/queue sized
+ * objects, occasional task stacks and pbuf-sized buffers, with lifetimes
+ * that vary enough to fragment a first-fit heap.
+ */
+static void generateTrace(size_t count, unsigned seed)
+{
+	uint32_t *live = calloc(count, sizeof(*live));
+	size_t numLive = 0;
+
+	srand(seed);
+
+	for (size_t i = 0; i < count; i++) {
+		int r = rand() % 100;
+
+		if (numLive > 0 && (r < 45 || numLive > 400)) {
+			size_t victim = (size_t)rand() % numLive;
+			addOp(0, live[victim], 0);
+			live[victim] = live[--numLive];
+		} else {
+			uint32_t size;
+			int kind = rand() % 100;
+
+			if (kind < 70)
+				size = 16 + (uint32_t)(rand() % 240);
+			else if (kind < 95)
+				size = 256 + (uint32_t)(rand() % 1500);
+			else
+				size = 2048 + (uint32_t)(rand() % 6144);
+
+			live[numLive++] = (uint32_t)numSlots;
+			addOp(1, (uint32_t)numSlots++, size);
+		}
+	}
+
+	free(live);
+}
+
+static inline uint64_t nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int cmpU32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void summarize(const char *what, uint32_t *samples, size_t n)
+{
+	uint64_t total = 0;
+
+	if (n == 0)
+		return;
+
+	for (size_t i = 0; i < n; i++)
+		total += samples[i];
+
+	qsort(samples, n, sizeof(*samples), cmpU32);
+
+	printf("  %-6s n=%-9zu mean=%6.1f ns  p50=%5u  p99=%6u  p99.9=%6u  max=%7u\n",
+		what, n, (double)total / (double)n, samples[n / 2],
+		samples[(n * 99) / 100], samples[(n * 999) / 1000], samples[n - 1]);
+}
+
+static void replay(const Allocator *a, int repeats)
+{
+	void **live = calloc(numSlots, sizeof(*live));
+	uint32_t *mallocNs = malloc(numOps * repeats * sizeof(uint32_t));
+	uint32_t *freeNs = malloc(numOps * repeats * sizeof(uint32_t));
+	size_t numMalloc = 0, numFree = 0, failed = 0;
+	HeapStats_t stats;
+
+	for (int r = 0; r < repeats; r++) {
+		for (size_t i = 0; i < numOps; i++) {
+			const TraceOp *op = &ops[i];
+			uint64_t t0;
+
+			if (op->isAlloc) {
+				t0 = nowNs();
+				live[op->slot] = a->malloc(op->size);
+				mallocNs[numMalloc++] = (uint32_t)(nowNs() - t0);
+				if (!live[op->slot])
+					failed++;
+			} else if (live[op->slot]) {
+				t0 = nowNs();
+				a->free(live[op->slot]);
+				freeNs[numFree++] = (uint32_t)(nowNs() - t0);
+				live[op->slot] = NULL;
+			}
+		}
+
+		/* Snapshot fragmentation at the end of the first pass, with
+		 * whatever the trace left allocated */
+		if (r == 0)
+			a->stats(&stats);
+
+		for (size_t s = 0; s < numSlots; s++) {
+			if (live[s]) {
+				a->free(live[s]);
+				live[s] = NULL;
+			}
+		}
+	}
+
+	printf("%s:\n", a->name);
+	summarize("malloc", mallocNs, numMalloc);
+	summarize("free", freeNs, numFree);
+	printf("  failed allocations: %zu\n", failed);
+	printf("  end of trace: %zu bytes free in %zu blocks, largest %zu, min ever free %zu\n",
+		stats.xAvailableHeapSpaceInBytes, stats.xNumberOfFreeBlocks,
+		stats.xSizeOfLargestFreeBlockInBytes, stats.xMinimumEverFreeBytesRemaining);
+
+	free(live);
+	free(mallocNs);
+	free(freeNs);
+}
+
+int main(int argc, char **argv)
+{
+	const char *tracePath = NULL;
+	size_t generate = 0;
+	unsigned seed = 1;
+	int repeats = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-g") && i + 1 < argc)
+			generate = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			seed = (unsigned)strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+			repeats = atoi(argv[++i]);
+		else
+			tracePath = argv[i];
+	}
+
+	if (generate)
+		generateTrace(generate, seed);
+	else if (tracePath)
+		loadTrace(tracePath);
+	else {
+		fprintf(stderr, "usage: %s <trace file> | -g <ops> [-s seed]  [-r repeats]\n", argv[0]);
+		return 1;
+	}
+
+	if (repeats < 1)
+		repeats = 1;
+
+	printf("%zu operations, %zu allocations, heap %zu bytes\n\n",
+		numOps, numSlots, (size_t)configTOTAL_HEAP_SIZE);
+
+	for (size_t i = 0; i < NUM_ALLOCATORS; i++)
+		replay(&allocators[i], repeats);
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+/*
+ * Just enough of FreeRTOS.h to compile heap_4.c and heap_tlsf.c on the host.
+ * The scheduler is not running, so the locking calls are no-ops.
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE				( ( size_t ) ( 65536 ) )
+#endif
+
+#define configSUPPORT_DYNAMIC_ALLOCATION	1
+#define configAPPLICATION_ALLOCATED_HEAP	0
+#define configUSE_MALLOC_FAILED_HOOK		0
+#define configASSERT( x )					assert( x )
+
+#define portBYTE_ALIGNMENT					8
+#define portBYTE_ALIGNMENT_MASK				( 0x0007 )
+#define portPOINTER_SIZE_TYPE				size_t
+#define portMAX_DELAY						( ( TickType_t ) ~( ( TickType_t ) 0 ) )
+
+#define PRIVILEGED_DATA
+#define PRIVILEGED_FUNCTION
+#define mtCOVERAGE_TEST_MARKER()
+#define traceMALLOC( pvAddress, uiSize )
+#define traceFREE( pvAddress, uiSize )
+
+#define pdFAIL								( ( BaseType_t ) 0 )
+#define pdPASS								( ( BaseType_t ) 1 )
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef size_t TickType_t;
+
+typedef struct xHeapStats
+{
+	size_t xAvailableHeapSpaceInBytes;
+	size_t xSizeOfLargestFreeBlockInBytes;
+	size_t xSizeOfSmallestFreeBlockInBytes;
+	size_t xNumberOfFreeBlocks;
+	size_t xMinimumEverFreeBytesRemaining;
+	size_t xNumberOfSuccessfulAllocations;
+	size_t xNumberOfSuccessfulFrees;
+} HeapStats_t;
+
+void * pvPortMalloc( size_t xSize );
+void * pvPortCalloc( size_t xNum, size_t xSize );
+void vPortFree( void * pv );
+void vPortInitialiseBlocks( void );
+size_t xPortGetFreeHeapSize( void );
+size_t xPortGetMinimumEverFreeHeapSize( void );
+void vPortGetHeapStats( HeapStats_t * pxHeapStats );
+
+#endif /* INC_FREERTOS_H */
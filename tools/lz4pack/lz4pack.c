@@ -0,0 +1,254 @@
+/*
+ * Compressor for the flasher's LZ4 program commands (flasher/lz4.h).
+ *
+ *	lz4pack BOOT.BIN BOOT.BIN.lz4
+ *
+ * Writes a standard LZ4 frame (`lz4 -d` reads it back) with 64KB linked
+ * blocks, the content size in the header and an XXH32 content checksum,
+ * which is what the flasher needs. The matcher is a plain greedy one with a
+ * single hash table; the point is the long runs of padding in a boot image,
+ * not the last few percent.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ4_MAGIC		0x184D2204
+#define LZ4_FLG			0x4C	/* version 01, content size, content checksum */
+#define LZ4_BD			0x40	/* 64KB blocks */
+#define LZ4_BLOCK_SIZE		0x10000
+#define LZ4_BLOCK_UNCOMPRESSED	0x80000000u
+
+#define MIN_MATCH		4
+#define MAX_OFFSET		65535
+#define LAST_LITERALS		5	/* a block ends with at least this many literals */
+#define MATCH_LIMIT		12	/* and its last match starts at least this far from the end */
+
+#define HASH_BITS		16
+
+#define XXH_PRIME1 2654435761u
+#define XXH_PRIME2 2246822519u
+#define XXH_PRIME3 3266489917u
+#define XXH_PRIME4 668265263u
+#define XXH_PRIME5 374761393u
+
+static uint8_t *readFile(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	uint8_t *data;
+	long len;
+
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	data = malloc(len + 1);
+	if (!data || fread(data, 1, len, f) != (size_t)len) {
+		fprintf(stderr, "%s: read failed\n", path);
+		fclose(f);
+		free(data);
+		return NULL;
+	}
+	fclose(f);
+
+	*size = len;
+	return data;
+}
+
+static uint32_t read32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+	return p + 4;
+}
+
+static uint32_t rotl32(uint32_t x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+/* XXH32 with seed 0, as the frame format uses for its checksums */
+static uint32_t xxh32(const uint8_t *data, size_t len)
+{
+	const uint8_t *end = data + len;
+	uint32_t h;
+
+	if (len >= 16) {
+		uint32_t v[4] = { XXH_PRIME1 + XXH_PRIME2, XXH_PRIME2, 0, 0 - XXH_PRIME1 };
+
+		for (; end - data >= 16; data += 16)
+			for (int k = 0; k < 4; k++)
+				v[k] = rotl32(v[k] + read32(data + 4 * k) * XXH_PRIME2, 13) * XXH_PRIME1;
+		h = rotl32(v[0], 1) + rotl32(v[1], 7) + rotl32(v[2], 12) + rotl32(v[3], 18);
+	} else {
+		h = XXH_PRIME5;
+	}
+	h += (uint32_t)len;
+
+	for (; end - data >= 4; data += 4)
+		h = rotl32(h + read32(data) * XXH_PRIME3, 17) * XXH_PRIME4;
+	for (; data < end; data++)
+		h = rotl32(h + *data * XXH_PRIME5, 11) * XXH_PRIME1;
+
+	h ^= h >> 15;
+	h *= XXH_PRIME2;
+	h ^= h >> 13;
+	h *= XXH_PRIME3;
+	h ^= h >> 16;
+	return h;
+}
+
+static uint32_t hash(uint32_t sequence)
+{
+	return (sequence * XXH_PRIME1) >> (32 - HASH_BITS);
+}
+
+/* The 255-terminated tail of a length that didn't fit its 4 bits */
+static uint8_t *putLength(uint8_t *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+static uint8_t *putSequence(uint8_t *op, const uint8_t *literals, size_t literalLen,
+		size_t offset, size_t matchLen)
+{
+	size_t match = matchLen ? matchLen - MIN_MATCH : 0;
+
+	*op++ = (literalLen < 15 ? literalLen : 15) << 4 | (match < 15 ? match : 15);
+	if (literalLen >= 15)
+		op = putLength(op, literalLen - 15);
+	memcpy(op, literals, literalLen);
+	op += literalLen;
+
+	if (matchLen) {
+		*op++ = offset;
+		*op++ = offset >> 8;
+		if (match >= 15)
+			op = putLength(op, match - 15);
+	}
+	return op;
+}
+
+/*
+ * Compresses data[start, end) into out. Matches may reach back into the
+ * blocks before, up to MAX_OFFSET; table holds position + 1 of the last
+ * place each hash was seen, 0 for never.
+ */
+static size_t compressBlock(const uint8_t *data, size_t start, size_t end, uint32_t *table,
+		uint8_t *out)
+{
+	uint8_t *op = out;
+	size_t anchor = start;
+	size_t pos = start;
+
+	while (pos + MATCH_LIMIT <= end) {
+		uint32_t sequence = read32(data + pos);
+		uint32_t *slot = &table[hash(sequence)];
+		size_t ref = *slot;
+		size_t len;
+
+		*slot = pos + 1;
+		if (ref == 0 || pos - (ref - 1) > MAX_OFFSET || read32(data + ref - 1) != sequence) {
+			pos++;
+			continue;
+		}
+		ref--;
+
+		len = MIN_MATCH;
+		while (pos + len < end - LAST_LITERALS && data[ref + len] == data[pos + len])
+			len++;
+
+		op = putSequence(op, data + anchor, pos - anchor, pos - ref, len);
+		pos += len;
+		anchor = pos;
+	}
+
+	op = putSequence(op, data + anchor, end - anchor, 0, 0);
+	return op - out;
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t header[15];
+	uint8_t *image, *block, *p;
+	uint32_t *table;
+	size_t size, packed;
+	FILE *f;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s BOOT.BIN BOOT.BIN.lz4\n", argv[0]);
+		return 2;
+	}
+
+	image = readFile(argv[1], &size);
+	if (!image)
+		return 1;
+
+	/* Worst case for incompressible data, before falling back to a raw block */
+	block = malloc(LZ4_BLOCK_SIZE + LZ4_BLOCK_SIZE / 255 + 16);
+	table = calloc(1u << HASH_BITS, sizeof(*table));
+	f = fopen(argv[2], "wb");
+	if (!block || !table || !f) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	p = put32(header, LZ4_MAGIC);
+	*p++ = LZ4_FLG;
+	*p++ = LZ4_BD;
+	p = put32(p, (uint32_t)size);
+	p = put32(p, (uint32_t)((uint64_t)size >> 32));
+	*p = xxh32(header + 4, p - (header + 4)) >> 8;
+	p++;
+	fwrite(header, 1, p - header, f);
+	packed = p - header;
+
+	for (size_t start = 0; start < size; start += LZ4_BLOCK_SIZE) {
+		size_t end = size - start > LZ4_BLOCK_SIZE ? start + LZ4_BLOCK_SIZE : size;
+		size_t len = compressBlock(image, start, end, table, block);
+		uint8_t word[4];
+
+		if (len >= end - start) {
+			put32(word, (uint32_t)(end - start) | LZ4_BLOCK_UNCOMPRESSED);
+			fwrite(word, 1, 4, f);
+			fwrite(image + start, 1, end - start, f);
+			len = end - start;
+		} else {
+			put32(word, (uint32_t)len);
+			fwrite(word, 1, 4, f);
+			fwrite(block, 1, len, f);
+		}
+		packed += 4 + len;
+	}
+
+	/* EndMark, then the content checksum */
+	put32(header, 0);
+	put32(header + 4, xxh32(image, size));
+	fwrite(header, 1, 8, f);
+	packed += 8;
+
+	if (fclose(f) != 0) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	printf("%s: %zu bytes, %zu compressed (%.1f%%)\n", argv[1], size, packed,
+			size ? 100.0 * packed / size : 0.0);
+	return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Checks the BSP's NEON memory routines against the C library and times them.
+ *
+ * Built as an ARM Linux binary and run under qemu-arm, where code runs in user
+ * mode and so always takes the NEON path for large sizes. Every routine is
+ * run over a sweep of lengths and source/destination alignments (and, for
+ * memmove, overlaps in both directions), inside a buffer with guard bytes on
+ * both sides so overruns are caught as well as wrong data.
+ *
+ * The throughput figures at the end only mean something on real hardware;
+ * under qemu they mostly measure the emulator.
+ *
+ * Usage:
+ *   membench [-q]		-q skips the timing pass
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "xil_types.h"
+#include "xil_mem.h"
+
+#define GUARD		64
+#define MAX_LEN		(64 * 1024 + 256)
+/* Room for a memmove of MAX_LEN bytes shifted by up to MAX_LEN either way */
+#define BUF_SIZE	(GUARD + 3 * MAX_LEN + 64 + GUARD)
+
+static uint8_t buf[BUF_SIZE] __attribute__ ((aligned (64)));
+static uint8_t expect[BUF_SIZE] __attribute__ ((aligned (64)));
+static uint8_t srcBuf[MAX_LEN + 64] __attribute__ ((aligned (64)));
+static unsigned failures;
+static unsigned tests;
+
+/*
+ * Only the window around the bytes a test writes, plus GUARD bytes each side,
+ * is refreshed and compared; a full-buffer pass per test would dominate the
+ * run time under qemu.
+ */
+static uint8_t *winLo;
+static uint8_t *winHi;
+
+static void fill(uint32_t seed, uint8_t *lo, uint8_t *hi, size_t srcLen)
+{
+	winLo = lo - GUARD;
+	winHi = hi + GUARD;
+	for (uint8_t *p = winLo; p < winHi; p++) {
+		seed = seed * 1103515245u + 12345u;
+		*p = (uint8_t)(seed >> 16);
+	}
+	memcpy(expect + (winLo - buf), winLo, winHi - winLo);
+
+	for (size_t i = 0; i < srcLen && i < sizeof(srcBuf); i++) {
+		seed = seed * 1103515245u + 12345u;
+		srcBuf[i] = (uint8_t)(seed >> 16);
+	}
+}
+
+static void check(const char *what, size_t len, size_t dstOff, long srcOff)
+{
+	const uint8_t *want = expect + (winLo - buf);
+	size_t size = winHi - winLo;
+
+	tests++;
+	if (memcmp(winLo, want, size) == 0)
+		return;
+
+	for (size_t i = 0; i < size; i++) {
+		if (winLo[i] != want[i]) {
+			printf("FAIL %s len %zu dst +%zu src %+ld: first bad byte at window offset %zu\n",
+					what, len, dstOff, srcOff, i);
+			break;
+		}
+	}
+	failures++;
+}
+
+static void checkCopy(size_t len, size_t dstOff, size_t srcOff)
+{
+	uint8_t *dst = buf + GUARD + dstOff;
+	const uint8_t *src = srcBuf + srcOff;
+	void *ret;
+
+	fill((uint32_t)(len * 977 + dstOff * 31 + srcOff), dst, dst + len, srcOff + len);
+	memcpy(expect + (dst - buf), src, len);
+	ret = Xil_MemCpyNeon(dst, src, (u32)len);
+	if (ret != dst) {
+		printf("FAIL memcpy len %zu: returned %p, expected %p\n", len, ret, (void *)dst);
+		failures++;
+	}
+	check("memcpy", len, dstOff, (long)srcOff);
+}
+
+static void checkMove(size_t len, size_t dstOff, long delta)
+{
+	uint8_t *dst = buf + GUARD + MAX_LEN + dstOff;
+	const uint8_t *src = dst - delta;
+	void *ret;
+
+	fill((uint32_t)(len * 131 + dstOff * 7 + (size_t)delta),
+			delta > 0 ? dst - delta : dst, delta > 0 ? dst + len : dst - delta + len, 0);
+	memmove(expect + (dst - buf), expect + (src - buf), len);
+	ret = Xil_MemMoveNeon(dst, src, (u32)len);
+	if (ret != dst) {
+		printf("FAIL memmove len %zu: returned %p, expected %p\n", len, ret, (void *)dst);
+		failures++;
+	}
+	check("memmove", len, dstOff, -delta);
+}
+
+static void checkSet(size_t len, size_t dstOff, int c)
+{
+	uint8_t *dst = buf + GUARD + dstOff;
+	void *ret;
+
+	fill((uint32_t)(len * 3 + dstOff), dst, dst + len, 0);
+	memset(expect + (dst - buf), c, len);
+	ret = Xil_MemSetNeon(dst, c, (u32)len);
+	if (ret != dst) {
+		printf("FAIL memset len %zu: returned %p, expected %p\n", len, ret, (void *)dst);
+		failures++;
+	}
+	check("memset", len, dstOff, 0);
+}
+
+static void runChecks(void)
+{
+	static const size_t bigLens[] = {
+		1023, 1024, 1025, 4095, 4096, 4097, 4131, 16384 + 17, 65536, MAX_LEN
+	};
+	static const long deltas[] = {
+		1, 2, 3, 4, 7, 8, 15, 16, 31, 32, 33, 63, 64, 65, 127, 128, 129, 1000
+	};
+	size_t len, d, s, i;
+
+	/* Every alignment pair for short and medium copies, which covers the
+	 * fallback, the head/tail byte loops and the 32 byte tail block */
+	for (len = 0; len <= 400; len++) {
+		for (d = 0; d < 32; d++) {
+			for (s = 0; s < 32; s++)
+				checkCopy(len, d, s);
+			checkSet(len, d, (int)(0x5a00 + len));
+		}
+	}
+
+	for (i = 0; i < sizeof(bigLens) / sizeof(bigLens[0]); i++) {
+		for (d = 0; d < 32; d += 5) {
+			for (s = 0; s < 32; s += 3)
+				checkCopy(bigLens[i], d, s);
+			checkSet(bigLens[i], d, 0xa5);
+		}
+	}
+
+	for (len = 0; len <= 300; len += (len < 140) ? 1 : 7) {
+		for (d = 0; d < 32; d += 3) {
+			for (i = 0; i < sizeof(deltas) / sizeof(deltas[0]); i++) {
+				checkMove(len, d, deltas[i]);
+				checkMove(len, d, -deltas[i]);
+			}
+			checkMove(len, d, 0);
+		}
+	}
+	for (i = 0; i < sizeof(bigLens) / sizeof(bigLens[0]); i++) {
+		for (d = 0; d < 32; d += 7) {
+			checkMove(bigLens[i], d, 1);
+			checkMove(bigLens[i], d, -1);
+			checkMove(bigLens[i], d, 100);
+			checkMove(bigLens[i], d, -100);
+			checkMove(bigLens[i], d, (long)bigLens[i] / 2);
+			checkMove(bigLens[i], d, -(long)bigLens[i] / 2);
+		}
+	}
+
+	printf("%u checks, %u failures\n", tests, failures);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double throughput(void *(*fn)(void *, const void *, u32), size_t len)
+{
+	size_t iterations = (64 * 1024 * 1024) / len;
+	double start = now();
+
+	for (size_t i = 0; i < iterations; i++)
+		fn(buf + GUARD, srcBuf + 4, (u32)len);
+
+	return (iterations * (double)len) / (now() - start) / (1024 * 1024);
+}
+
+static void *libcMemcpy(void *dst, const void *src, u32 len)
+{
+	return memcpy(dst, src, len);
+}
+
+static void runTimings(void)
+{
+	static const size_t lens[] = { 64, 128, 256, 512, 1024, 4096, 16384, 65536 };
+
+	printf("\n%8s %12s %12s   (MB/s, only meaningful on hardware)\n",
+			"bytes", "memcpy", "neon");
+	for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+		printf("%8zu %12.1f %12.1f\n", lens[i],
+				throughput(libcMemcpy, lens[i]), throughput(Xil_MemCpyNeon, lens[i]));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	runChecks();
+	if (!(argc > 1 && strcmp(argv[1], "-q") == 0))
+		runTimings();
+
+	return failures ? 1 : 0;
+}
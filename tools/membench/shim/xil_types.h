@@ -0,0 +1,12 @@
+/* Just enough of xil_types.h for xil_mem.h */
+#ifndef XIL_TYPES_H
+#define XIL_TYPES_H
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int32_t s32;
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Client for the app's network update service (app/src/FlashUpdate.h).
+ *
+ *	netflash <board-ip> BOOT.BIN
+ *
+ * Streams the image to the board, which writes it to its inactive boot slot
+ * as it arrives, and waits for the board to confirm that every block was
+ * written, read back and matches the image's CRC-32, and that the slot is
+ * now the one that boots. Exits 0 only then.
+ * The wire format assumes a little-endian host.
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "FlashUpdate.h"
+
+/* Per block the board may need a 64KB erase; allow plenty for that */
+#define REPLY_TIMEOUT_S		60
+
+static const char *statusNames[] = {
+	[FLASH_UPDATE_OK] = "ok",
+	[FLASH_UPDATE_BAD_HEADER] = "bad header",
+	[FLASH_UPDATE_FLASH_ERROR] = "flash error",
+	[FLASH_UPDATE_VERIFY_FAILED] = "verify failed",
+	[FLASH_UPDATE_CRC_MISMATCH] = "CRC mismatch",
+};
+
+static uint8_t *readFile(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	uint8_t *data;
+	long len;
+
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	data = malloc(len + 1);
+	if (!data || fread(data, 1, len, f) != (size_t)len) {
+		fprintf(stderr, "%s: read failed\n", path);
+		fclose(f);
+		free(data);
+		return NULL;
+	}
+
+	fclose(f);
+	*size = len;
+	return data;
+}
+
+/* zlib's CRC-32, the same one the board computes */
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	while (len--) {
+		crc ^= *data++;
+		for (int k = 0; k < 8; k++)
+			crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+	}
+	return ~crc;
+}
+
+static int sendAll(int fd, const void *data, size_t len)
+{
+	const uint8_t *src = data;
+
+	while (len > 0) {
+		ssize_t n = send(fd, src, len, 0);
+
+		if (n <= 0)
+			return -1;
+		src += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int recvAll(int fd, void *data, size_t len)
+{
+	uint8_t *dst = data;
+
+	while (len > 0) {
+		ssize_t n = recv(fd, dst, len, 0);
+
+		if (n <= 0)
+			return -1;
+		dst += n;
+		len -= n;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	FlashUpdateHeader header;
+	FlashUpdateReply reply;
+	struct sockaddr_in addr;
+	struct timeval timeout = { REPLY_TIMEOUT_S, 0 };
+	uint8_t *image;
+	size_t size, sent;
+	int fd;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s board-ip BOOT.BIN\n", argv[0]);
+		return 2;
+	}
+
+	image = readFile(argv[2], &size);
+	if (!image)
+		return 1;
+	if (size == 0 || size > FLASH_UPDATE_MAX_SIZE) {
+		fprintf(stderr, "%s: %zu bytes doesn't fit a boot slot\n", argv[2], size);
+		return 1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(FLASH_UPDATE_PORT);
+	if (inet_pton(AF_INET, argv[1], &addr.sin_addr) != 1) {
+		fprintf(stderr, "%s: not an IPv4 address\n", argv[1]);
+		return 2;
+	}
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	header.magic = FLASH_UPDATE_MAGIC;
+	header.size = size;
+	header.crc32 = crc32(image, size);
+	printf("%s: %zu bytes, CRC32 0x%08x\n", argv[2], size, header.crc32);
+
+	if (sendAll(fd, &header, sizeof(header)) != 0) {
+		perror("send");
+		return 1;
+	}
+
+	/* The board takes data as fast as it can write it, so progress here
+	 * tracks the flash */
+	for (sent = 0; sent < size; ) {
+		size_t chunk = size - sent > 65536 ? 65536 : size - sent;
+
+		if (sendAll(fd, image + sent, chunk) != 0) {
+			fprintf(stderr, "\nconnection lost after %zu bytes\n", sent);
+			return 1;
+		}
+		sent += chunk;
+		printf("\r%zu%%", sent * 100 / size);
+		fflush(stdout);
+	}
+	printf("\n");
+
+	if (recvAll(fd, &reply, sizeof(reply)) != 0) {
+		fprintf(stderr, "no reply from the board\n");
+		return 1;
+	}
+	close(fd);
+
+	printf("board: %s, CRC32 0x%08x, slot %c", reply.status < sizeof(statusNames) / sizeof(statusNames[0]) ?
+			statusNames[reply.status] : "unknown status", reply.crc32, SLOT_NAME(reply.slot));
+	if (reply.status == FLASH_UPDATE_OK)
+		printf(" boots next, sequence %u", reply.sequence);
+	printf("\n");
+	return reply.status == FLASH_UPDATE_OK ? 0 : 1;
+}